@@ -2,6 +2,7 @@
 #define ALIGN_ACTIONS_HPP_INCLUDED
 
 #include "model/while_topo.hpp"
+#include "model/perception.hpp"
 #include "model/action_base.hpp"
 
 
@@ -14,6 +15,12 @@ namespace model {
     { // align by turning with all neighbors
 
       make_action_from_this(align_n);
+      static constexpr bool neighbor_reducer = true;
+
+      struct accumulator
+      {
+        vec_t adir = vec_t(0.f);
+      };
 
     public:
       align_n() {}
@@ -35,23 +42,30 @@ namespace model {
 
       void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
       {
-        const auto sv = sim.sorted_view<Tag>(idx);
         const auto& flock = sim.pop<Tag>();
-        
-		    vec_t adir(0.f);
-        auto realized_topo = while_topo(sv, topo, [&](const auto& ni) {
-
-          if (in_fov(self, ni.dist2, flock[ni.idx].pos, this))
-          {
-            adir += flock[ni.idx].dir;
-            return true;
-          }
-          return false;
+        accumulator acc;
+        auto realized_topo = perception<Agent>::while_topo(self, topo, [&](const auto& p) {
+          return reduce(acc, p, self, flock);
         });
+        apply(self, acc, realized_topo);
+      }
 
-        const vec_t Fdir = math::save_normalize(adir, vec_t(0.f)) * w_; 
-        self->f_ali_ang = math::rad_between(self->dir, Fdir);
- 		self->steering += Fdir;
+      template <typename Pop>
+      bool reduce(accumulator& acc, const percept& p, const agent_type* self, const Pop& flock) const
+      {
+        if (in_fov(p, this))
+        {
+          acc.adir += flock[p.idx].dir();
+          return true;
+        }
+        return false;
+      }
+
+      void apply(agent_type* self, const accumulator& acc, size_t realized_topo)
+      {
+        const vec_t Fdir = math::save_normalize(acc.adir, vec_t(0.f)) * w_; 
+        self->f_ali_ang = math::rad_between(self->dir(), Fdir);
+ 		self->steering() += Fdir;
       }
 
     public:
@@ -5,6 +5,7 @@
 #include <glmutils/ray.hpp>
 #include <glmutils/random.hpp>
 #include "model/while_topo.hpp"
+#include "model/perception.hpp"
 
 namespace model {
   namespace actions {
@@ -15,6 +16,12 @@ namespace model {
     { // avoid neighbors position
 
       make_action_from_this(avoid_n_position);
+      static constexpr bool neighbor_reducer = true;
+
+      struct accumulator
+      {
+        vec_t ofss = vec_t(0.f);
+      };
 
     public:
       avoid_n_position() {}
@@ -40,26 +47,33 @@ namespace model {
 
       void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
       {
-        const auto sv = sim.sorted_view<Tag>(idx);
         const auto& flock = sim.pop<Tag>();
+        accumulator acc;
+        auto realized_topo = perception<Agent>::while_topo(self, topo, [&](const auto& p) {
+          return reduce(acc, p, self, flock);
+        });
+        apply(self, acc, realized_topo);
+      }
 
-        auto ofss = vec_t(0);
-        auto realized_topo = while_topo(sv, topo, [&](const auto& ni) {
-
-          if (in_fov(self, ni.dist2, flock[ni.idx].pos, this))
+      template <typename Pop>
+      bool reduce(accumulator& acc, const percept& p, const agent_type* self, const Pop& flock) const
+      {
+        if (in_fov(p, this))
+        {
+          if (p.dist2 < minsep2)
           {
-            if (ni.dist2 < minsep2)
-            {
-				ofss += torus::ofs(Simulation::WH(), flock[ni.idx].pos, self->pos);
-              return true;
-            }
+            acc.ofss -= p.ofs;
+            return true;
           }
-          return false;
-        });
+        }
+        return false;
+      }
 
-		const vec_t Fdir = math::save_normalize(ofss, vec_t(0.f)) * w_;
-        self->f_sep_ang = math::rad_between(self->dir, Fdir);
-		self->steering += Fdir;
+      void apply(agent_type* self, const accumulator& acc, size_t realized_topo)
+      {
+		const vec_t Fdir = math::save_normalize(acc.ofss, vec_t(0.f)) * w_;
+        self->f_sep_ang = math::rad_between(self->dir(), Fdir);
+		self->steering() += Fdir;
       }
 
        public:
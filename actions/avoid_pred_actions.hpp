@@ -38,10 +38,10 @@ namespace model {
         if (nv.size() && (nv[0].dist2 < minsep2))
         {
           const auto& predator = sim.pop<pred_tag>()[nv[0].idx];    // nearest predator
-		  if (predator.target_i >= 0 && static_cast<size_t>(predator.target_i) == idx) { self->am_target = true; } else { self->am_target = false; }
-          const auto ofss = torus::ofs(Simulation::WH(), predator.pos, self->pos);
+		  if (predator.target_i >= 0 && static_cast<size_t>(predator.target_i) == sim.id<Tag>(idx)) { self->am_target = true; } else { self->am_target = false; }
+          const auto ofss = torus::ofs(Simulation::WH(), predator.pos(), self->pos());
 		  const auto Fdir = math::save_normalize(ofss, vec_t(0.f)) * w_;
-		  self->steering += Fdir;
+		  self->steering() += Fdir;
         }
       }
 
@@ -81,11 +81,11 @@ namespace model {
 			if (nv.size() && (nv[0].dist2 < minsep2))
 			{
 				const auto& predator = sim.pop<pred_tag>()[nv[0].idx];    // nearest predator
-				const float rad_away_pred = math::rad_between(predator.dir, self->dir);
-				if (predator.target_i >= 0 && static_cast<size_t>(predator.target_i) == idx) { self->am_target = true; }
+				const float rad_away_pred = math::rad_between(predator.dir(), self->dir());
+				if (predator.target_i >= 0 && static_cast<size_t>(predator.target_i) == sim.id<Tag>(idx)) { self->am_target = true; }
 				else { self->am_target = false; }
 				auto w = std::copysignf(w_, rad_away_pred);
-				self->steering += glmutils::perpDot(self->dir) * w;
+				self->steering() += glmutils::perpDot(self->dir()) * w;
 			}
 		}
 
@@ -116,7 +116,7 @@ namespace model {
 		{
 			// we want to turn turn_ radians in time_ seconds.
 			auto w = turn_ / time_;       // required angular velocity
-			r_ = self->speed / w;       // radius
+			r_ = self->speed() / w;       // radius
 
 			// find direction away from predator
 			const auto nv = sim.sorted_view<Tag, pred_tag>(idx); 
@@ -124,10 +124,10 @@ namespace model {
 			if (nv.size())
 			{
 				const auto& predator = sim.pop<pred_tag>()[nv[0].idx];    // nearest predator
-				if (predator.target_i >= 0 && static_cast<size_t>(predator.target_i) == idx) { self->am_target = true; }
+				if (predator.target_i >= 0 && static_cast<size_t>(predator.target_i) == sim.id<Tag>(idx)) { self->am_target = true; }
 				else { self->am_target = false; }
-				auto dir_away = glm::normalize(torus::ofs(Simulation::WH(), predator.pos, self->pos));
-				w_ = (glmutils::perpDot(self->dir, dir_away) > 0) ? 1.f : -1.f; // perp dot positive, b on right of a (for perpdot(a,b))
+				auto dir_away = glm::normalize(torus::ofs(Simulation::WH(), predator.pos(), self->pos()));
+				w_ = (glmutils::perpDot(self->dir(), dir_away) > 0) ? 1.f : -1.f; // perp dot positive, b on right of a (for perpdot(a,b))
 			}
 			else
 			{
@@ -139,9 +139,9 @@ namespace model {
 		void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 		{
 			// Fz = m * v*v/r 
-			turn_dir_ = w_ * glmutils::perpDot(self->dir);
-			auto Fz = self->ai.bodyMass * self->speed * self->speed / r_;
-			self->steering += Fz * turn_dir_;
+			turn_dir_ = w_ * glmutils::perpDot(self->dir());
+			auto Fz = self->ai.bodyMass * self->speed() * self->speed() / r_;
+			self->steering() += Fz * turn_dir_;
 		}
 
 	private:
@@ -182,12 +182,13 @@ namespace model {
 		void on_entry(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 		{
 			// we want to turn turn_ radians in time_ seconds.
-			const auto thisturn = turn_distr_(model::reng);
-			auto loc_time = time_distr_(model::reng);
+			auto rng = sim.rng<Tag>(idx, T, rng_stream::turn);
+			const auto thisturn = turn_distr_(rng);
+			auto loc_time = time_distr_(rng);
 			turn_dur_ = static_cast<tick_t>(static_cast<double>(loc_time) / Simulation::dt());
 
 			auto w = thisturn / loc_time;       // required angular velocity
-			r_ = self->speed / w;       // radius
+			r_ = self->speed() / w;       // radius
 
 			// find direction away from predator
 			const auto nv = sim.sorted_view<Tag, pred_tag>(idx);
@@ -195,11 +196,11 @@ namespace model {
 			if (nv.size())
 			{
 				const auto& predator = sim.pop<pred_tag>()[nv[0].idx];    // nearest predator
-				//auto dir_away = glm::normalize(torus::ofs(Simulation::WH(), predator.pos, self->pos));
-				//w_ = (glmutils::perpDot(self->dir, dir_away) > 0) ? 1.f : -1.f; // perp dot positive, b on right of a (for perpdot(a,b))
-				if (predator.target_i >= 0 && static_cast<size_t>(predator.target_i) == idx) { self->am_target = true; }
+				//auto dir_away = glm::normalize(torus::ofs(Simulation::WH(), predator.pos(), self->pos()));
+				//w_ = (glmutils::perpDot(self->dir(), dir_away) > 0) ? 1.f : -1.f; // perp dot positive, b on right of a (for perpdot(a,b))
+				if (predator.target_i >= 0 && static_cast<size_t>(predator.target_i) == sim.id<Tag>(idx)) { self->am_target = true; }
 				else { self->am_target = false; }
-				const float rad_away_pred = math::rad_between(predator.dir, self->dir);
+				const float rad_away_pred = math::rad_between(predator.dir(), self->dir());
 				w_ = std::copysignf(1.f, rad_away_pred);
 			}
 			else
@@ -211,9 +212,9 @@ namespace model {
 		void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 		{
 			// Fz = m * v*v/r 
-			turn_dir_ = w_ * glmutils::perpDot(self->dir);
-			auto Fz = self->ai.bodyMass * self->speed * self->speed / r_;
-			self->steering += Fz * turn_dir_;
+			turn_dir_ = w_ * glmutils::perpDot(self->dir());
+			auto Fz = self->ai.bodyMass * self->speed() * self->speed() / r_;
+			self->steering() += Fz * turn_dir_;
 
 		}
 
@@ -264,15 +265,16 @@ namespace model {
 			// we want to turn turn_ radians in time_ seconds.
 			auto loc_time = 0.f; // random to initialize
 			auto thisturn = 0.f; // random to initialize
+			auto rng = sim.rng<Tag>(idx, T, rng_stream::turn);
 			do {
-				loc_time = time_distr_(model::reng);
-				thisturn = turn_distr_(model::reng);
+				loc_time = time_distr_(rng);
+				thisturn = turn_distr_(rng);
 			} while ( loc_time * thisturn <= 0.f ); // both not 0
 
 			turn_dur_ = static_cast<tick_t>(static_cast<double>(loc_time) / Simulation::dt());
 
 			auto w = thisturn / loc_time;       // required angular velocity
-			r_ = self->speed / w;       // radius
+			r_ = self->speed() / w;       // radius
 
 			// find direction away from predator
 			const auto nv = sim.sorted_view<Tag, pred_tag>(idx);
@@ -280,7 +282,7 @@ namespace model {
 			if (nv.size())
 			{
 				const auto& predator = sim.pop<pred_tag>()[nv[0].idx];    // nearest predator
-				const float rad_away_pred = math::rad_between(predator.dir, self->dir);
+				const float rad_away_pred = math::rad_between(predator.dir(), self->dir());
 				w_ = std::copysignf(1.f, rad_away_pred);
 			}
 			else
@@ -292,9 +294,9 @@ namespace model {
 		void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 		{
 			// Fz = m * v*v/r 
-			turn_dir_ = w_ * glmutils::perpDot(self->dir);
-			auto Fz = self->ai.bodyMass * self->speed * self->speed / r_;
-			self->steering += Fz * turn_dir_;
+			turn_dir_ = w_ * glmutils::perpDot(self->dir());
+			auto Fz = self->ai.bodyMass * self->speed() * self->speed() / r_;
+			self->steering() += Fz * turn_dir_;
 
 		}
 
@@ -333,7 +335,7 @@ namespace model {
 
 			// we want to turn turn_ radians in time_ seconds.
 			auto w = 2.f * turn_ / time_;       // required angular velocity
-			r_ = self->speed / w;       // radius
+			r_ = self->speed() / w;       // radius
 		
 			//find direction away from predator
 			const auto nv = sim.sorted_view<Tag, pred_tag>(idx); // add through runtime error if no predator? SHOULD CHECK IF PREDATOR? BUT SHOULD ONLY BE WHEN PREDATOR AROUND ANYWAYS
@@ -342,10 +344,10 @@ namespace model {
 			if (nv.size())
 			{
 				const auto& predator = sim.pop<pred_tag>()[nv[0].idx];    // nearest predator
-				if (predator.target_i >= 0 && static_cast<size_t>(predator.target_i) == idx) { self->am_target = true; }
+				if (predator.target_i >= 0 && static_cast<size_t>(predator.target_i) == sim.id<Tag>(idx)) { self->am_target = true; }
 				else { self->am_target = false; }
-				auto dir_away = glm::normalize(torus::ofs(Simulation::WH(), predator.pos, self->pos));
-				w_ = (glmutils::perpDot(self->dir, dir_away) > 0) ? 1.f : -1.f; // dot positive, b on right of a (for dot(a,b))
+				auto dir_away = glm::normalize(torus::ofs(Simulation::WH(), predator.pos(), self->pos()));
+				w_ = (glmutils::perpDot(self->dir(), dir_away) > 0) ? 1.f : -1.f; // dot positive, b on right of a (for dot(a,b))
 			}
 			else
 			{
@@ -357,10 +359,10 @@ namespace model {
 		void operator()(agent_type * self, size_t idx, tick_t T, const Simulation & sim)
 		{
 			// Fz = m * v*v/r
-			turn_dir_ = w_ * glmutils::perpDot(self->dir);
+			turn_dir_ = w_ * glmutils::perpDot(self->dir());
 
-			auto Fz = self->ai.bodyMass * self->speed * self->speed / r_;
-			self->steering += Fz * turn_dir_;
+			auto Fz = self->ai.bodyMass * self->speed() * self->speed() / r_;
+			self->steering() += Fz * turn_dir_;
 
 			if ((T - entry_tick_) > zig_timer_) 
 			{
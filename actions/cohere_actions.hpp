@@ -2,6 +2,7 @@
 #define COHERE_TURN_ACTIONS_HPP_INCLUDED
 
 #include "model/action_base.hpp"
+#include "model/perception.hpp"
 
 namespace model {
   namespace actions {
@@ -11,6 +12,12 @@ namespace model {
     { // cohere by turning with all neighbors
 
       make_action_from_this(cohere_turn_n_all);
+      static constexpr bool neighbor_reducer = true;
+
+      struct accumulator
+      {
+        vec_t ofss = vec_t(0.f);
+      };
 
     public:
       cohere_turn_n_all() {}
@@ -33,23 +40,30 @@ namespace model {
 
       void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
       {
-        const auto sv = sim.sorted_view<Tag>(idx);
         const auto& flock = sim.pop<Tag>();
-
-        auto ofss = vec_t(0.f);
-        auto realized_topo = while_topo(sv, topo, [&](const auto& ni) {
-
-          if (in_fov(self, ni.dist2, flock[ni.idx].pos, this))
-          {
-		       	ofss += torus::ofs(Simulation::WH(), self->pos, flock[ni.idx].pos);
-            return true;
-          }
-          return false;
+        accumulator acc;
+        auto realized_topo = perception<Agent>::while_topo(self, topo, [&](const auto& p) {
+          return reduce(acc, p, self, flock);
         });
+        apply(self, acc, realized_topo);
+      }
 
-		      const auto Fdir = math::save_normalize(ofss, vec_t(0.f)) * w_;
-              self->f_coh_ang = math::rad_between(self->dir, Fdir);
-		      self->steering += Fdir;
+      template <typename Pop>
+      bool reduce(accumulator& acc, const percept& p, const agent_type* self, const Pop& flock) const
+      {
+        if (in_fov(p, this))
+        {
+          acc.ofss += p.ofs;
+          return true;
+        }
+        return false;
+      }
+
+      void apply(agent_type* self, const accumulator& acc, size_t realized_topo)
+      {
+		      const auto Fdir = math::save_normalize(acc.ofss, vec_t(0.f)) * w_;
+              self->f_coh_ang = math::rad_between(self->dir(), Fdir);
+		      self->steering() += Fdir;
       }
 
     public:
@@ -2,6 +2,7 @@
 #define COHERE_SPEED_ACTIONS_HPP_INCLUDED
 
 #include "model/action_base.hpp"
+#include "model/perception.hpp"
 
 namespace model {
   namespace actions {
@@ -11,6 +12,12 @@ namespace model {
     {  // cohere by speed change with neighbors positioned in front
 
       make_action_from_this(cohere_accel_n_front);
+      static constexpr bool neighbor_reducer = true;
+
+      struct accumulator
+      {
+        float av_f_dist2 = 0.f;   // average distance to neighbors
+      };
 
     public:
       cohere_accel_n_front() {}
@@ -23,6 +30,7 @@ namespace model {
         auto fov = J["fov"]; // [deg]
         ffov = J["ffov"];    // [deg]
         cfov = glm::cos(glm::radians(180.0f - 0.5f * (360.0f - float(fov)))); // [1]
+        cffov = std::cos(glm::radians(180.0f - 0.5f * (360.0f - ffov)));      // [1]
 
 		    float maxdist = J["maxdist"];     // [m]
 		    maxdist2 = maxdist * maxdist;     // [m^2]
@@ -39,33 +47,42 @@ namespace model {
 
 	    void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 	    {
-		    const auto nv = sim.sorted_view<Tag>(idx);
-		    const auto& flock = sim.pop<Tag>();
+        const auto& flock = sim.pop<Tag>();
+        accumulator acc;
+		    auto realized_topo = perception<Agent>::while_topo(self, topo, [&](const auto& p) {
+          return reduce(acc, p, self, flock);
+		    });
+        apply(self, acc, realized_topo);
+      }
 
-            auto av_f_dist2 = 0.f; // average distance to neighbors
-		    auto realized_topo = while_topo(nv, topo, [&](const auto& ni) {
-   		  if (in_fov(self, ni.dist2, flock[ni.idx].pos, this))
+      template <typename Pop>
+      bool reduce(accumulator& acc, const percept& p, const agent_type* self, const Pop& flock) const
+      {
+   		  if (in_fov(p, this))
 			  {
-				  if (!(torus::is_atside(self->pos, self->dir, flock[ni.idx].pos, ffov, Simulation::WH())))
+				  if (p.front > p.dist * cffov)   // not at side, see torus::is_atside
 				  {
-					  av_f_dist2 += ni.dist2;
+					  acc.av_f_dist2 += p.dist2;
 					  return true;
 				  }
                   return false;
 			  }
 			  return false;
-		    });
+      }
 
+      void apply(agent_type* self, const accumulator& acc, size_t realized_topo)
+      {
         auto w = (realized_topo) ?
-              math::smootherstep(std::sqrt(av_f_dist2) / realized_topo, minacceldist2, maxacceldist2)
+              math::smootherstep(std::sqrt(acc.av_f_dist2) / realized_topo, minacceldist2, maxacceldist2)
              : - decel_w_;
-		self->steering += w_ * w * self->dir;
+		self->steering() += w_ * w * self->dir();
 	  }
 
     public:
       int topo = 0;         // [1]
       float cfov = 0;       // [1]
       float ffov = 0;       // [deg] front field of view
+      float cffov = 0;      // [1]
       float maxdist2 = 0;   // [m^2]
 	  float minacceldist2 = 0; // [m^2]
 	  float maxacceldist2 = 0; // [m^2]
@@ -38,12 +38,12 @@ namespace model {
 				if (sv.size())
 				{ 
 					const auto& target = sim.pop<pigeon_tag>()[sv[0].idx]; // nearest prey
-					auto ofss = torus::ofs(Simulation::WH(), self->pos, target.pos);;
+					auto ofss = torus::ofs(Simulation::WH(), self->pos(), target.pos());;
 
 					const auto Fdir = math::save_normalize(ofss, vec_t(0.f)) * w_;
-					self->steering += Fdir;
-					self->speed = prey_speed_scale_ * target.speed;
-					self->target_i = static_cast<int>(sv[0].idx);
+					self->steering() += Fdir;
+					self->speed() = prey_speed_scale_ * target.speed();
+					self->target_i = static_cast<int>(sim.id<pigeon_tag>(sv[0].idx));
 				}
 			}
 
@@ -73,7 +73,7 @@ namespace model {
 				const auto sv = sim.sorted_view<Tag, pigeon_tag>(idx);
 				if (sv.size())
 				{
-					target_idx_ = sv[0].idx; // nearest prey
+					target_idx_ = sim.id<pigeon_tag>(sv[0].idx); // nearest prey, external id
 					self->target_i = static_cast<int>(target_idx_);
 				}
 			}
@@ -86,11 +86,11 @@ namespace model {
 			{
 				if (target_idx_ != -1)
 				{
-					const auto& target = sim.pop<pigeon_tag>()[target_idx_]; // nearest prey
-					auto ofss = torus::ofs(Simulation::WH(), self->pos, target.pos);;
+					const auto& target = sim.pop<pigeon_tag>()[sim.idx_of<pigeon_tag>(target_idx_)]; // nearest prey
+					auto ofss = torus::ofs(Simulation::WH(), self->pos(), target.pos());;
 					const auto Fdir = math::save_normalize(ofss, vec_t(0.f)) * w_;
-					self->steering += Fdir;
-					self->speed = prey_speed_scale_ * target.speed;
+					self->steering() += Fdir;
+					self->speed() = prey_speed_scale_ * target.speed();
 				}
 			}
 
@@ -129,10 +129,10 @@ namespace model {
 				if (sv.size())
 				{
 					const auto& flock_ind = sim.pop<pigeon_tag>()[sv[0].idx]; // nearest prey
-					auto ofss = torus::ofs(Simulation::WH(), flock_ind.pos, self->pos);;
+					auto ofss = torus::ofs(Simulation::WH(), flock_ind.pos(), self->pos());;
 
 					const auto Fdir = math::save_normalize(ofss, vec_t(0.f)) * w_;
-					self->steering += Fdir;
+					self->steering() += Fdir;
 				}
 			}
 
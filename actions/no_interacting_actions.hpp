@@ -28,8 +28,9 @@ namespace model {
 
       void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
       {
-        auto w = std::uniform_real_distribution<float>(-w_, w_)(reng); // [rad]
-		    self->steering += glmutils::perpDot(self->dir) * w;
+        auto rng = sim.rng<Tag>(idx, T, rng_stream::wiggle);
+        auto w = std::uniform_real_distribution<float>(-w_, w_)(rng); // [rad]
+		    self->steering() += glmutils::perpDot(self->dir()) * w;
       }
 
     private:
@@ -59,8 +60,8 @@ namespace model {
       void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
       {
         // Fz = m * v*v/r
-        auto Fz = self->ai.bodyMass * self->speed * self->speed / turn_;
-		    self->steering += Fz * glmutils::perpDot(self->dir);
+        auto Fz = self->ai.bodyMass * self->speed() * self->speed() / turn_;
+		    self->steering() += Fz * glmutils::perpDot(self->dir());
       }
 
     private:
@@ -89,14 +90,14 @@ namespace model {
       {
         // we want to turn turn_ radians in time_ seconds.
         auto w = turn_ / time_;       // required angular velocity
-        r_ = self->speed / w;       // radius
+        r_ = self->speed() / w;       // radius
       }
 
       void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
       {
         // Fz = m * v*v/r
-        auto Fz = self->ai.bodyMass * self->speed * self->speed / r_;
-        self->steering += Fz * glmutils::perpDot(self->dir);
+        auto Fz = self->ai.bodyMass * self->speed() * self->speed() / r_;
+        self->steering() += Fz * glmutils::perpDot(self->dir());
       }
 
     private:
@@ -34,9 +34,9 @@ namespace model {
 
 			void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 			{
-				self->pos = pos_;
-				self->dir = dir_;
-				self->speed = speed_;
+				self->pos() = pos_;
+				self->dir() = dir_;
+				self->speed() = speed_;
 			}
 
 		private:
@@ -70,10 +70,10 @@ namespace model {
 
 			void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 			{
-				const auto& target = sim.pop<pigeon_tag>()[self->target_f];
-				self->pos = target.pos + dist_ * math::rotate(target.dir, bearing_);
-				self->dir = target.dir;
-				self->speed = prey_speed_scale_ * target.speed;
+				const auto& target = sim.pop<pigeon_tag>()[sim.idx_of<pigeon_tag>(self->target_f)];
+				self->pos() = target.pos() + dist_ * math::rotate(target.dir(), bearing_);
+				self->dir() = target.dir();
+				self->speed() = prey_speed_scale_ * target.speed();
 			}
 
 		private:
@@ -107,9 +107,9 @@ namespace model {
 
 			void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 			{
-				self->pos = torus::wrap(Simulation::WH(), self->pos + dist_away_ * math::rotate(self->dir, math::pi<float>));
-				self->dir = math::rotate(self->dir, math::pi<float>);
-				self->speed = speed_;
+				self->pos() = torus::wrap(Simulation::WH(), self->pos() + dist_away_ * math::rotate(self->dir(), math::pi<float>));
+				self->dir() = math::rotate(self->dir(), math::pi<float>);
+				self->speed() = speed_;
 			}
 
 		private:
@@ -143,9 +143,9 @@ namespace model {
 
 			void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 			{
-				auto ofs = torus::ofs(Simulation::WH(), self->pos, torus::wrap(Simulation::WH(), pos_));
-				const auto Fdir = math::save_normalize(ofs, self->dir) * w_;
-				self->steering += Fdir;
+				auto ofs = torus::ofs(Simulation::WH(), self->pos(), torus::wrap(Simulation::WH(), pos_));
+				const auto Fdir = math::save_normalize(ofs, self->dir()) * w_;
+				self->steering() += Fdir;
 			}
 
 		public:
@@ -169,7 +169,7 @@ namespace model {
 
 			void on_entry(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 			{
-				pos_ = self->pos;
+				pos_ = self->pos();
 			}
 			void check_state_exit(const tick_t& state_dur, tick_t& state_exit_t)
 			{
@@ -177,9 +177,9 @@ namespace model {
 
 			void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 			{
-				auto ofs = torus::ofs(Simulation::WH(), self->pos, torus::wrap(Simulation::WH(), pos_));
-				const auto Fdir = math::save_normalize(ofs, self->dir) * w_;
-				self->steering += Fdir;
+				auto ofs = torus::ofs(Simulation::WH(), self->pos(), torus::wrap(Simulation::WH(), pos_));
+				const auto Fdir = math::save_normalize(ofs, self->dir()) * w_;
+				self->steering() += Fdir;
 			}
 
 		public:
@@ -217,11 +217,11 @@ namespace model {
 
 			void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 			{
-				auto ofs = torus::ofs(Simulation::WH(), self->pos, torus::wrap(Simulation::WH(), pos_));
-				const auto Fdir = math::save_normalize(ofs, self->dir);
-				self->steering += w_ * Fdir;
+				auto ofs = torus::ofs(Simulation::WH(), self->pos(), torus::wrap(Simulation::WH(), pos_));
+				const auto Fdir = math::save_normalize(ofs, self->dir());
+				self->steering() += w_ * Fdir;
 				const auto dd = glm::length2(ofs);
-				const auto b = std::abs(glm::dot(self->dir, Fdir));
+				const auto b = std::abs(glm::dot(self->dir(), Fdir));
 				if ((dd < tolerance_[0]) && ((dd < tolerance_[1]) || (b < tolerance_[2]))) {
 					self->on_state_exit(idx, T, sim);
 				}
@@ -261,7 +261,7 @@ namespace model {
 
 			void on_entry(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 			{
-				select_target(self, sim);
+				select_target(self, idx, T, sim);
 			}
 
 			void check_state_exit(const tick_t& state_dur, tick_t& state_exit_t)
@@ -270,18 +270,18 @@ namespace model {
 
 			void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 			{
-				select_target(self, sim);
+				select_target(self, idx, T, sim);
 			}
 
 		private:
-			void select_target(agent_type* self, const Simulation& sim)
+			void select_target(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 			{
 				const auto& flocks = sim.flocks<pigeon_tag>();
 				auto it = flocks.cend();
 
 				switch (selection_) {
 				case Selection::Nearest:
-					it = std::min_element(flocks.cbegin(), flocks.cend(), [pos = self->pos](const auto& a, const auto& b) {
+					it = std::min_element(flocks.cbegin(), flocks.cend(), [pos = self->pos()](const auto& a, const auto& b) {
 						return torus::distance2(Simulation::WH(), a.gc(), pos) <
 							torus::distance2(Simulation::WH(), b.gc(), pos);
 					});
@@ -299,7 +299,8 @@ namespace model {
 				case Selection::Random:
 					if (!flocks.empty()) {
 						auto dist = std::uniform_int_distribution<size_t>(0ull, flocks.size() - 1);
-						it = flocks.cbegin() + dist(reng);
+						auto rng = sim.rng<Tag>(idx, T, rng_stream::target);
+						it = flocks.cbegin() + dist(rng);
 					}
 					break;
 				default:
@@ -307,8 +308,14 @@ namespace model {
 				}
 				self->target_f = -1;
 				if (it != flocks.cend()) {
+					// alive member with the smallest id, independent of the member order
 					const auto flock_id = static_cast<size_t>(std::distance(flocks.cbegin(), it));
-					self->target_f = sim.flock_mates<pigeon_tag>(flock_id)[0];
+					for (auto i : sim.flock_members<pigeon_tag>(flock_id)) {
+						const auto id = static_cast<int>(sim.id<pigeon_tag>(i));
+						if (sim.is_alive<pigeon_tag>(i) && (self->target_f == -1 || id < self->target_f)) {
+							self->target_f = id;
+						}
+					}
 				}
 			}
 
@@ -335,9 +342,9 @@ namespace model {
 			void on_entry(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 			{
 				if (placement_ ) { // IF FIRST ACTION OF PREDATOR FAILS
-					const auto& target = sim.pop<pigeon_tag>()[self->target_f];
-					self->pos = target.pos + dist_ * math::rotate(target.dir, bearing_);
-					self->dir = target.dir;
+					const auto& target = sim.pop<pigeon_tag>()[sim.idx_of<pigeon_tag>(self->target_f)];
+					self->pos() = target.pos() + dist_ * math::rotate(target.dir(), bearing_);
+					self->dir() = target.dir();
 				}
 			}
 
@@ -348,12 +355,12 @@ namespace model {
 			void operator()(agent_type* self, size_t idx, tick_t T, const Simulation& sim)
 			{
 				if (-1 != self->target_f) {
-					const auto& target = sim.pop<pigeon_tag>()[self->target_f];
-					const auto pos = target.pos + dist_ * math::rotate(target.dir, bearing_);
-					const auto ofs = torus::ofs(Simulation::WH(), self->pos, torus::wrap(Simulation::WH(), pos));
-					const auto Fdir = math::save_normalize(ofs, self->dir);
-					self->steering += w_ * Fdir;
-					self->speed = prey_speed_scale_ * target.speed;
+					const auto& target = sim.pop<pigeon_tag>()[sim.idx_of<pigeon_tag>(self->target_f)];
+					const auto pos = target.pos() + dist_ * math::rotate(target.dir(), bearing_);
+					const auto ofs = torus::ofs(Simulation::WH(), self->pos(), torus::wrap(Simulation::WH(), pos));
+					const auto Fdir = math::save_normalize(ofs, self->dir());
+					self->steering() += w_ * Fdir;
+					self->speed() = prey_speed_scale_ * target.speed();
 				}
 			}
 
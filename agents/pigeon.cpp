@@ -28,17 +28,13 @@ namespace model {
   }
 
 
+  // kinematic state from kinematic_store::reset
   Pigeon::Pigeon(size_t idx, const json& J) :
-    current_state_(0),
-    pos(0, 0),
-    dir(1, 0),
-    accel(0) // [m / s^2]
+    current_state_(0)
   {
    
     pa_ = AP::create(idx, J["states"]); 
     ai = flight::create_aero_info<float>(J["aero"]);
-    sa.w = 0.f; // until they get value from state (first integrates before update)
-    speed = sa.cruiseSpeed = ai.cruiseSpeed; 
 
   }
 
@@ -51,8 +47,8 @@ namespace model {
   {
     float tex = -1.f;
     switch (color_map) {
-    case 1: tex = float(idx) / sim->pop<Tag>().size(); break;
-    case 2: tex = glm::clamp(speed / ai.maxSpeed, 0.f, 1.f); break;
+    case 1: tex = float(sim->id<Tag>(idx)) / sim->pop<Tag>().size(); break;
+    case 2: tex = glm::clamp(speed() / ai.maxSpeed, 0.f, 1.f); break;
     case 3: {
       tex = 0.5f + flight_control::bank(this) / math::pi<float>; break;
     }
@@ -61,36 +57,32 @@ namespace model {
     case 6: tex = float(am_target); 
     };
     tex = std::clamp(tex, -1.f, 1.f);  // yes -1,+1, need '-1' in shader
-    return { pos, speed * dir, glmutils::perpDot(dir), tex };
+    return { pos(), speed() * dir(), glmutils::perpDot(dir()), tex };
   }
 
   ::model::snapshot_entry<pigeon_tag> Pigeon::snapshot(const Simulation* sim, size_t idx) const noexcept
   {
-    return { pos, dir, speed , accel};
+    return { pos(), dir(), speed(), accel() };
   }
 
   void Pigeon::snapshot(Simulation* sim, size_t idx, const snapshot_entry<pigeon_tag>& se) noexcept
   {
-    pos = se.pos;
-    speed = se.speed;
-	dir = se.dir; 
-	accel = se.accel;
+    pos() = se.pos;
+    speed() = se.speed;
+    dir() = se.dir;
+    accel() = se.accel;
   }
 
   size_t Pigeon::update(size_t idx, tick_t T, const Simulation& sim)
   {
-    steering = vec_t(0); 
+    steering() = vec_t(0);
     am_target = false;
+    perception<Pigeon>::perceive(this, idx, sim);
     pa_[current_state_]->resume(this, idx, T, sim);
     last_update = T;
     return T + reaction_time;
   }
 
-  void Pigeon::integrate(tick_t T, const Simulation& sim)
-  {
-    flight_control::integrate_motion(this);    
-  }
-
   void Pigeon::on_state_exit(size_t idx, tick_t T, const Simulation& sim)
   {
   }
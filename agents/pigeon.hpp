@@ -16,6 +16,7 @@
 #include "actions/no_interacting_actions.hpp"
 #include "model/flight_control.hpp"
 #include "model/flight.hpp"
+#include "model/kinematics.hpp"
 #include "model/json.hpp"
 
 
@@ -47,7 +48,7 @@ namespace model {
       vec_t accel = vec_t(0);
   };
 
-  class Pigeon
+  class Pigeon : public kinematic_handle
   {
   public:
     using Tag = pigeon_tag;
@@ -73,7 +74,6 @@ namespace model {
 
     // returns next update time
     tick_t update(size_t idx, tick_t T, const Simulation& sim);
-    void integrate(tick_t T, const Simulation& sim);
     void on_state_exit(size_t idx, tick_t T, const Simulation& sim);
 
     ::model::instance_proxy instance_proxy(long long color_map, size_t idx, const class Simulation* sim) const noexcept;
@@ -85,24 +85,16 @@ namespace model {
     const int& get_current_state() const noexcept { return current_state_; }
 
   public:
-    // accessible from states:
-    pos_t pos;   // [m]
-    vec_t dir;
-    float speed;  // [m/tick]
-    float ang_vel = 0; // [ 1/s ] Only for extracting data, not used in model
-    vec_t accel;  // [m/tick ^ 2]
+    // accessible from states, kinematic state from kinematic_handle:
     tick_t reaction_time = 0;   // [ticks]
     tick_t last_update = 0; 
     bool am_target = false; // if individual is a the target of the predator
     std::array<float, AP::size> tm; // transition matrix line per state change evaluation for export
-    vec_t force;             // reserved for physical forces  [kg * m/tick^2]
     float f_ali_ang = 0.f;        // angle of alignment force
     float f_coh_ang = 0.f;         // angle of coherence force
     float f_sep_ang = 0.f;        // angle of separation force
-    vec_t steering;    // linear, lateral  [kg * m/tick^2]
 
     flight::aero_info<float> ai;
-    flight::state_aero<float> sa;
     static std::vector<snapshot_entry<Tag>> init_pop(const Simulation& sim, const json& J);
 
   private:
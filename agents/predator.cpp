@@ -11,7 +11,6 @@ namespace model {
 
   // Predator
 
-  decltype(Pred::transitions_) Pred::transitions_;
   // flight::aero_info<float> Pred::ai;
   //const flight::aero_info<float>& Pred::ai = Pred::ai;
 
@@ -36,20 +35,14 @@ namespace model {
   }
 
 
+  // kinematic state from kinematic_store::reset
   Pred::Pred(size_t idx, const json& J) :
     current_state_(0),
     target_i(-1),
     target_f(-1),
-    pos(0, 0),
-    dir(1, 0),
-    accel(0) // [m / s^2]
+    transitions_(J)
   {
-    if (idx == 0) {
-      transitions_ = decltype(transitions_)(J);
-    }
     ai = flight::create_aero_info<float>(J["aero"]);
-    speed = sa.cruiseSpeed = ai.cruiseSpeed;
-    sa.w = 0.f; // until they get value from state? (first integrates before update)
     pa_ = AP::create(idx, J["states"]);
   }
 
@@ -62,40 +55,35 @@ namespace model {
   {
     float tex = -1.f;
     switch (color_map) {
-      case 1: tex = speed / 30.f; break;
+      case 1: tex = speed() / 30.f; break;
       case 2: tex = float(current_state_) / AP::size; break;
     };
     tex = std::clamp(tex, -1.f, 1.f);  // yes -1,+1, need '-1' in shader
-    return { pos, speed * dir, glmutils::perpDot(dir), tex };
+    return { pos(), speed() * dir(), glmutils::perpDot(dir()), tex };
   }
 
   ::model::snapshot_entry<pred_tag> Pred::snapshot(const Simulation* sim, size_t idx) const noexcept
   {
-    return { pos,  dir, speed , accel, sim->is_alive<Tag>(idx) };
+    return { pos(), dir(), speed(), accel(), sim->is_alive<Tag>(idx) };
   }
 
   void Pred::snapshot(Simulation* sim, size_t idx, const snapshot_entry<pred_tag>& se) noexcept
   {
-    pos = se.pos;
-    speed = se.speed;
-    dir = se.dir;
-    accel = se.accel;
+    pos() = se.pos;
+    speed() = se.speed;
+    dir() = se.dir;
+    accel() = se.accel;
     sim->set_alive<Tag>(idx, se.alive);
   }
 
   size_t Pred::update(size_t idx, tick_t T, const Simulation& sim)
   {
-    steering = vec_t(0);
+    steering() = vec_t(0);
     pa_[current_state_]->resume(this, idx, T, sim);
     last_update = T;
     return T + reaction_time;
   }
 
-  void Pred::integrate(tick_t T, const Simulation& sim)
-  {
-    flight_control::integrate_motion(this);
-  }
-
   void Pred::on_state_exit(size_t idx, tick_t T, const Simulation& sim)
   {
     target_i = -1;
@@ -103,7 +91,8 @@ namespace model {
     auto& dist = pred_discrete_dist;
     const auto TM = transitions_(0.f);
     pred_discrete_dist.mutate(TM[current_state_].cbegin(), TM[current_state_].cend());
-    current_state_ = pred_discrete_dist(reng);
+    auto rng = sim.rng<Tag>(idx, T, rng_stream::state);
+    current_state_ = pred_discrete_dist(rng);
     pa_[current_state_]->enter(this, idx, T, sim);
   }
 }
@@ -14,6 +14,7 @@
 #include "model/transitions.hpp"
 #include "model/flight_control.hpp"
 #include "model/flight.hpp"
+#include "model/kinematics.hpp"
 #include "model/json.hpp"
 
 
@@ -67,7 +68,7 @@ namespace model {
 
 
 
-  class Pred
+  class Pred : public kinematic_handle
   {
   public:
     using Tag = pred_tag;
@@ -101,7 +102,6 @@ namespace model {
 
     // returns next update time
     tick_t update(size_t idx, tick_t T, const Simulation& sim);
-    void integrate(tick_t T, const Simulation& sim);
     void on_state_exit(size_t idx, tick_t T, const Simulation& sim);
 
     static float distance2(const pos_t& a, const pos_t& b) {
@@ -119,25 +119,17 @@ namespace model {
     const int& get_current_state() const noexcept { return current_state_; }
 
   public:
-    // accessible from states
-    pos_t pos;
-    vec_t dir;
-    float ang_vel = 0; // [ 1/s ] Only for extracting data, not used in model
+    // accessible from states, kinematic state from kinematic_handle
     tick_t reaction_time = 0;   // [ticks]
     tick_t last_update = 0;
-    float speed = 0.f;            // [m/tick]
-    vec_t accel;  // [m/tick ^ 2]
-    vec_t force;             // reserved for physical forces  [kg * m/tick^2]
-    vec_t steering;    // linear, lateral  [kg * m/tick^2]
-    int target_f; // flock target
-    int target_i; // individual target
+    int target_f; // flock target, external id
+    int target_i; // individual target, external id
     
     flight::aero_info<float> ai;
-	  flight::state_aero<float> sa;
 
   private:
     int current_state_ = 0;
-    static transitions transitions_;
+    transitions transitions_;
     AP::package_array pa_;
   };
 
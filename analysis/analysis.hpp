@@ -6,10 +6,10 @@
 #include "simgl/AppWin.h"
 #endif
 #include <filesystem>
-#include <deque>
 #include <sstream>
 #include <cstring>
 #include <cstdlib>
+#include <random>
 #include <time.h>
 #include "model/flock.hpp"
 #include "model/simulation.hpp"
@@ -20,23 +20,22 @@ using namespace model;
 
 namespace analysis
 {
-	using timeseries_t = std::deque<std::vector<float>>;
 	using path_t = std::filesystem::path;
 
 	template <typename Agent>
   inline float head_dif(const Agent& p, const model::flock_descr& f)
   {
-		return math::rad_between(p.dir, f.vel);
+		return math::rad_between(p.dir(), f.vel);
   }
 
 	template <typename PreyAgent, typename PredAgent>
 	inline float in_conflict_pos(const PreyAgent& prey, const PredAgent& pred, const model::flock_descr& f)
 	{
-		auto dir_towards_fl = glm::normalize(torus::ofs(Simulation::WH(), prey.pos, f.gc()));
-		auto dir_away_pred = glm::normalize(torus::ofs(Simulation::WH(), pred.pos, prey.pos));
+		auto dir_towards_fl = glm::normalize(torus::ofs(Simulation::WH(), prey.pos(), f.gc()));
+		auto dir_away_pred = glm::normalize(torus::ofs(Simulation::WH(), pred.pos(), prey.pos()));
 
-		auto dot_p = (glmutils::perpDot(prey.dir, dir_away_pred) > 0) ? 0 : 1;
-		auto dot_f = (glmutils::perpDot(prey.dir, dir_towards_fl) > 0) ? 0 : 1;
+		auto dot_p = (glmutils::perpDot(prey.dir(), dir_away_pred) > 0) ? 0 : 1;
+		auto dot_f = (glmutils::perpDot(prey.dir(), dir_towards_fl) > 0) ? 0 : 1;
 		return (dot_p != dot_f) ? 1.f : 0.f ;
 	}
 
@@ -44,9 +43,9 @@ namespace analysis
 	template <typename PreyAgent, typename PredAgent>
 	inline float in_conflict_dir_coh(const PreyAgent& prey, const PredAgent& pred, const model::flock_descr& f)
 	{
-		auto dir_towards_fl = glm::normalize(torus::ofs(Simulation::WH(), prey.pos, f.gc()));
-		auto rad_away_pred = math::rad_between(pred.dir, prey.dir);
-		auto rad_to_fl = math::rad_between(prey.dir, dir_towards_fl);
+		auto dir_towards_fl = glm::normalize(torus::ofs(Simulation::WH(), prey.pos(), f.gc()));
+		auto rad_away_pred = math::rad_between(pred.dir(), prey.dir());
+		auto rad_to_fl = math::rad_between(prey.dir(), dir_towards_fl);
 
 		return ((rad_away_pred * rad_to_fl) < 0) ? 1.f : 0.f;
 	}
@@ -55,14 +54,14 @@ namespace analysis
 	template <typename PreyAgent, typename PredAgent>
 	inline float in_conflict_dir_ali(const PreyAgent& prey, const PredAgent& pred, const model::flock_descr& f)
 	{
-		auto rad_away_pred = math::rad_between(pred.dir, prey.dir);
-		auto rad_to_fl = math::rad_between(prey.dir, f.vel);
+		auto rad_away_pred = math::rad_between(pred.dir(), prey.dir());
+		auto rad_to_fl = math::rad_between(prey.dir(), f.vel);
 
 		return ((rad_away_pred * rad_to_fl) < 0) ? 1.f : 0.f;
 	}
 
-	template <typename Agent>
-	inline float centrality(const Agent& pf, const size_t& idxf, const model::Simulation& sim)
+	template <typename Agent, typename Src>
+	inline float centrality(const Agent& pf, const size_t& idxf, const Src& sim)
 	{
 		//const auto sv = sim.sorted_view<pigeon_tag>(idxf);
 		//const auto& flock = sim.pop<pigeon_tag>();
@@ -71,29 +70,21 @@ namespace analysis
 		//for (auto it = sv.cbegin(); it != sv.cend(); ++it) {
 		//	if (sim.flock_of<pigeon_tag>(idxf) == sim.flock_of<pigeon_tag>(it->idx))
 		//	{
-		//		adir += torus::ofs(Simulation::WH(), pf.pos, flock[it->idx].pos);
+		//		adir += torus::ofs(Simulation::WH(), pf.pos(), flock[it->idx].pos());
 		//		++n;
 		//	}
 		//}
 
-		vec_t adir(0.f);
-		auto n = 0.f; // number of neighbors
-		sim.visit_all<pigeon_tag>([&](auto& p, size_t idx, bool alive) {
-			if (alive && idx != idxf)
-			{
-				if (sim.flock_of<pigeon_tag>(idxf) == sim.flock_of<pigeon_tag>(idx))
-				{
-					adir += torus::ofs(Simulation::WH(), pf.pos, p.pos);
-					++n;
-				}	
-			}
-		});
-
-		if (n)
+		// sum of offsets to the mates from the flock sums, O(1)
+		const auto fl = sim.template flock_of<pigeon_tag>(idxf);
+		const auto& fs = sim.template flock_sums<pigeon_tag>();
+		if (fl < 0 || static_cast<size_t>(fl) >= fs.size() || fs[fl].n < 2)
 		{
-			return glm::length(adir / n);
+			return 0.f;
 		}
-		return 0.f;
+		const auto n = static_cast<float>(fs[fl].n);
+		const auto adir = fs[fl].ofs - n * torus::ofs(Simulation::WH(), fs[fl].anchor, pf.pos());
+		return glm::length(adir / (n - 1.f));
 	}
 
 	inline path_t output_path(const json& J)
@@ -121,7 +112,8 @@ namespace analysis
 	inline path_t unique_output_folder(const json& J)
 	{
 		auto distr = std::uniform_int_distribution<int>(0, 1000);
-		const auto random_id = std::to_string(distr(model::reng));
+		auto rd = std::random_device{};   // not model::reng, runs with the same seed shall not collide
+		const auto random_id = std::to_string(distr(rd));
 
 		struct std::tm local_time;
 	    const std::time_t now = time(0);
@@ -145,90 +137,12 @@ namespace analysis
 		return filefolder;
 	}
 
-	template < size_t P, typename VecType >
-	struct do_write_csv 
-	{
-		static void write_in_csv(std::ofstream& outFile, VecType& i) // or std::deque<std::vector<float>>::const_iterator
-		{
-			outFile << i[P-1] ;
-			outFile << ',';
-			do_write_csv<P - 1, VecType>::write_in_csv(outFile, i);
-		}
-	};
-
-	template< typename VecType >
-	struct do_write_csv<1, VecType>
-	{
-		static void write_in_csv(std::ofstream& outFile, VecType& i)
-		{
-			outFile << i[1] << std::endl;
-		}
-	};
-
-
-	inline void open_csv(std::ofstream& outFile, const std::string& full_path, const std::string& header)
-  {
-    outFile.open(full_path);
-    outFile << header << std::endl;
-  }
-
-  template < size_t P, typename DecType>
-	void export_data(const DecType& data_out, std::ofstream& outFile)
-  {
-    if (P != data_out[0].size()) { std::cout << "Warning: size of saving vector different that defined, data might be missing." << std::endl; }
-
-    for (auto i : data_out)
-    {
-      do_write_csv<P, typename DecType::value_type>::write_in_csv(outFile, i);
-    }
-  }
-
-	template <typename DecType>
-	void export_data(const DecType& data_out, std::ofstream& outFile)
-	{
-		for (auto i : data_out)
-		{
-			size_t p = i.size() - 1;
-			while (!(i.empty()) && p != 0)
-			{
-				outFile << i[p] << ',';
-				i.pop_back();
-				--p;
-			}
-			outFile << i[0] << std::endl;
-		}
-	}
-
-
-	template < size_t P, typename DecType>
-	inline void export_csv(const DecType& data_out, const std::string& full_path, const std::string& header)
+	inline path_t run_output_folder(const json& J)
 	{
-		if (P != data_out[0].size()) { std::cout << "Warning: size of saving vector different that defined, data might be missing." << std::endl; }
-		
-		std::ofstream outFile;
-
-		outFile.open(full_path);
-		outFile << header << std::endl;
-		for (auto i : data_out) 
-		{
-			do_write_csv<P, typename DecType::value_type>::write_in_csv(outFile, i);
-		}
-		outFile.close();
-	}
-
-	template < size_t P, typename DecType>
-	inline void export_csv(const DecType& data_out, const std::string& full_path)
-	{
-		if (P != data_out[0].size()) { std::cout << "Warning: size of saving vector different that defined, data might be missing." << std::endl; }
-
-		std::ofstream outFile;
-
-		outFile.open(full_path, std::ios_base::app);
-		for (auto i : data_out)
-		{
-			do_write_csv<P, typename DecType::value_type>::write_in_csv(outFile, i);
-		}
-		outFile.close();
+		const std::string run_folder = J["run_folder"];
+		const path_t filefolder = output_path(J) / run_folder;
+		std::filesystem::create_directories(filefolder);
+		return filefolder;
 	}
 }
 #endif
@@ -1,6 +1,7 @@
 #ifndef ANALYSIS_OBS_HPP_INCLUDED
 #define ANALYSIS_OBS_HPP_INCLUDED
 
+#include <limits>
 #include <analysis/analysis.hpp>
 
 namespace analysis
@@ -12,54 +13,57 @@ namespace analysis
 		TimeSeriesObserver(const std::filesystem::path& out_path, const json& J)
 			: AnalysisObserver(out_path, J)
 		{
-			analysis::open_csv(outfile_stream_, full_out_path_, header_);
+			open_table(header_of(columns_));
 		}
 		~TimeSeriesObserver() override {}
 
-		void notify_collect(const model::Simulation& sim) override
+		void notify_collect(const model::Simulation& sim) override { collect(sim); }
+		void notify_collect(const model::tick_sample& smp) override { collect(smp); }
+		bool async_collect() const noexcept override { return true; }
+
+		template <typename Src>
+		void collect(const Src& sim)
 		{
 			const auto tt = static_cast<float>(sim.tick()) * model::Simulation::dt();
 
-			sim.visit_all<Tag>([&](auto& p, size_t idx, bool alive) {
-				// csv writing backwards, so vectors backwards from header, new element to be added in front
+			sim.template visit_all<Tag>([&](auto& p, size_t idx, bool alive) {
 				if (alive) {
-					const auto& nv = sim.sorted_view<Tag, pred_tag>(idx); // predators
+					const auto& nv = sim.template sorted_view<Tag, pred_tag>(idx); // predators
 					//const auto& fi = sim.flocks<Tag>();										// all flocks
-					const auto fl_id = sim.flock_of<Tag>(idx);
-					const auto& thisflock = sim.flocks<Tag>()[fl_id];
-					const auto dist2cent = torus::distance(Simulation::WH(), p.pos, thisflock.gc()); // distance to center of flock
-					const auto dir2fcent = glm::normalize(torus::ofs(Simulation::WH(), p.pos, thisflock.gc()));
-					const auto head_dev = glm::degrees(math::rad_between(p.dir, thisflock.vel));		 // deviation of self heading to flocks heading
+					const auto fl_id = sim.template flock_of<Tag>(idx);
+					const auto& thisflock = sim.template flocks<Tag>()[fl_id];
+					const auto dist2cent = torus::distance(Simulation::WH(), p.pos(), thisflock.gc()); // distance to center of flock
+					const auto dir2fcent = glm::normalize(torus::ofs(Simulation::WH(), p.pos(), thisflock.gc()));
+					const auto head_dev = glm::degrees(math::rad_between(p.dir(), thisflock.vel));		 // deviation of self heading to flocks heading
 					const auto centr = centrality(p, idx, sim);
-					const auto rad2fcent = math::rad_between(p.dir, dir2fcent);
+					const auto rad2fcent = math::rad_between(p.dir(), dir2fcent);
 					auto confl = -1.f; // confict scenario -1 if no predator present
 					auto dist2pred = -1.f; // if no predator present
 					auto radAwayPred = -1.f; // if no predator present
 					vec_t dir2pred(-1.f, -1.f);
 					if (nv.size())
 					{
-						const auto& predator = sim.pop<pred_tag>()[nv[0].idx];    // nearest predator
-						dist2pred = torus::distance(Simulation::WH(), p.pos, predator.pos);
+						const auto& predator = sim.template pop<pred_tag>()[nv[0].idx];    // nearest predator
+						dist2pred = torus::distance(Simulation::WH(), p.pos(), predator.pos());
 						confl = in_conflict_dir_ali(p, predator, thisflock);
-						dir2pred = glm::normalize(torus::ofs(Simulation::WH(), p.pos, predator.pos));
-						radAwayPred = math::rad_between(predator.dir, p.dir);
+						dir2pred = glm::normalize(torus::ofs(Simulation::WH(), p.pos(), predator.pos()));
+						radAwayPred = math::rad_between(predator.dir(), p.dir());
 					}
-				  const auto nn = sim.sorted_view<Tag>(idx).cbegin(); // nearest neighbor
-				  data_out_.push_back({ confl, dir2pred.y, dir2pred.x, dist2pred, radAwayPred, dir2fcent.y, dir2fcent.x, rad2fcent, dist2cent, head_dev, static_cast<float>(fl_id), static_cast<float>(p.get_current_state()), centr, p.ang_vel, p.accel.y, p.accel.x, p.speed, p.dir.y,  p.dir.x,  p.pos.y, p.pos.x, static_cast<float>(idx), tt });
+				  const auto nn = sim.template sorted_view<Tag>(idx).cbegin(); // nearest neighbor
+				  data_out_.push(columns_, tt, sim.template id<Tag>(idx), p.pos().x, p.pos().y, p.dir().x, p.dir().y, p.speed(), p.accel().x, p.accel().y, p.ang_vel(), centr, p.get_current_state(), thisflock.id, head_dev, dist2cent, rad2fcent, dir2fcent.x, dir2fcent.y, radAwayPred, dist2pred, dir2pred.x, dir2pred.y, confl);
 				}
-				//data_out_.push_back({});
 			});
 		}
 
-		void notify_save(const model::Simulation& sim) override
+		void export_rows(const rows_t& rows) override
 		{
-			if (data_out_.empty()) { return; }
+			if (rows.empty()) { return; }
 			std::cout << "Saving timeseries data.." << std::endl;
-			analysis::export_data(data_out_, outfile_stream_);
+			out_.write(rows);
 		}
 
 	private:
-		const std::string header_ = "time,id,posx,posy,dirx,diry,speed,accelx,accely,ang_vel,centr,state,f_id,diff_head,dist2fcent,rad2fcent,dirX2fcent,dirY2fcent,radAwayPred,dist2pred,dirX2pred,dirY2pred,conflict";
+		static constexpr row_schema<23> columns_ = { "time", "id", "posx", "posy", "dirx", "diry", "speed", "accelx", "accely", "ang_vel", "centr", "state", "f_id", "diff_head", "dist2fcent", "rad2fcent", "dirX2fcent", "dirY2fcent", "radAwayPred", "dist2pred", "dirX2pred", "dirY2pred", "conflict" };
 	};
 
 
@@ -70,39 +74,72 @@ namespace analysis
 		FlockObserver(const std::filesystem::path & out_path, const json& J)
 			: AnalysisObserver(out_path, J)
 		{
-			analysis::open_csv(outfile_stream_, full_out_path_, header_);
+			open_table(header_of(columns_));
 		}
 		~FlockObserver() override {}
 
-		void notify_collect(const model::Simulation& sim) override
+		void notify_collect(const model::Simulation& sim) override { collect(sim); }
+		void notify_collect(const model::tick_sample& smp) override { collect(smp); }
+		bool async_collect() const noexcept override { return true; }
+
+		template <typename Src>
+		void collect(const Src& sim)
 		{
-			const auto& fi = sim.flocks<Tag>();
-			size_t idx = 0;
+			const auto& fi = sim.template flocks<Tag>();
 			const auto tt = static_cast<float>(sim.tick())* model::Simulation::dt();
-			// csv writing backwards, so vectors backwards from header, new element to be added in front
 			for (auto& i : fi)
 			{
         //auto tc = analysis::turn_correl(i, sim);
-				data_out_.push_back({ i.H[1].y, i.H[1].x, i.H[0].y, i.H[0].x, i.ext.y, i.ext.x, i.H[2].y, i.H[2].x, i.vel.y, i.vel.x, static_cast<float>(i.size), static_cast<float>(idx), tt });
-				++idx;    
+				data_out_.push(columns_, tt, i.id, i.size, i.vel.x, i.vel.y, i.H[2].x, i.H[2].y, i.ext.x, i.ext.y, i.H[0].x, i.H[0].y, i.H[1].x, i.H[1].y);
 			}
 		}
 
-		void notify_save(const model::Simulation& sim) override
+		void export_rows(const rows_t& rows) override
 		{ 
-			if (data_out_.empty()) { return;	}
+			if (rows.empty()) { return;	}
+			std::cout << "Saving flock data.." << std::endl;
+			out_.write(rows);
+		}
 
-			if (n_param_ > data_out_[0].size()) {
-				std::cout << "Warning: size of saving vector lower than defined, data wont be saved." << std::endl;
-				return;
+	private:
+		static constexpr row_schema<13> columns_ = { "time", "id", "size", "velx", "vely", "fcX", "fcY", "obbExtX", "obbExtY", "obbH0X", "obbH0Y", "obbH1X", "obbH1Y" };
+	};
+
+
+	template <typename Tag>
+	class FlockEventsObserver : public model::AnalysisObserver
+	{
+	public:
+		FlockEventsObserver(const std::filesystem::path& out_path, const json& J)
+			: AnalysisObserver(out_path, J)
+		{
+			oi_.sample_tick = oi_.sample_freq = 1;   // events are not sampled
+			open_table(header_of(columns_));
+		}
+		~FlockEventsObserver() override {}
+
+		void notify_collect(const model::Simulation& sim) override
+		{
+			const auto& ev = sim.flock_events<Tag>();
+			if (ev.empty() || ev.front().tick == last_tick_) { return; }
+			last_tick_ = ev.front().tick;
+			const auto tt = static_cast<float>(last_tick_) * model::Simulation::dt();
+			for (const auto& e : ev)
+			{
+				data_out_.push(columns_, tt, e.kind, e.id, e.other);
 			}
-			std::cout << "Saving flock data.." << std::endl;
-			analysis::export_data(data_out_, outfile_stream_);
+		}
+
+		void export_rows(const rows_t& rows) override
+		{
+			if (rows.empty()) { return; }
+			std::cout << "Saving flock events.." << std::endl;
+			out_.write(rows);
 		}
 
 	private:
-		static const size_t n_param_ = 13; // number of parameters to save
-		const std::string header_ = "time,id,size,velx,vely,fcX,fcY,obbExtX,obbExtY,obbH0X,obbH0Y,obbH1X,obbH1Y";
+		tick_t last_tick_ = static_cast<tick_t>(-1);
+		static constexpr row_schema<4> columns_ = { "time", "event", "id", "other" };   // event: 0 split, 1 merge
 	};
 
 
@@ -120,48 +157,40 @@ namespace analysis
 
 		void notify_once(const model::Simulation& sim) override
 		{
+		  data_out_.reset(columns_.size(), sim.pop<Tag>().size());
 		  notify_collect(sim);
 
 	      if (data_out_.empty()) { return; }
 
 		  const auto filepath = full_out_path_.string() + "_" + std::to_string(n_) + ".csv";
-		  const std::string header = "id,posx,posy,dirx,diry,speed,accelx,accely";
-		  analysis::open_csv(outfile_stream_, filepath, header);
-		  notify_save(sim, outfile_stream_);
-		  outfile_stream_.close();
+		  table_stream out;
+		  out.open(filepath, header_of(columns_), table_format::csv);
+		  notify_save(sim, out);
 		}
 
 		void notify_collect(const model::Simulation& sim)
 		{
 		  sim.visit_all<Tag>([&](auto& p, size_t idx, bool alive) {
-			// csv writing backwards, so vectors backwards from header, new element to be added in front
 			if (alive) 
 			{
-				data_out_.push_back({ p.accel.y, p.accel.x, p.speed, p.dir.y,  p.dir.x,  p.pos.y, p.pos.x, static_cast<float>(idx) });
+				data_out_.push(columns_, sim.id<Tag>(idx), p.pos().x, p.pos().y, p.dir().x, p.dir().y, p.speed(), p.accel().x, p.accel().y);
 			}
 		  });
 		}
 
-		void notify_save(const model::Simulation& sim, std::ofstream& outFile)
+		void notify_save(const model::Simulation& sim, table_stream& out)
 		{
-			if (n_param_ > data_out_[0].size()) {
-				std::cout << "Warning: size of saving vector lower than defined, data wont be saved." << std::endl;
-				data_out_.clear();
-				return;
-			}
 			std::cout << "Taking data snapshot.." << std::endl;
-	  		analysis::export_data<n_param_>(data_out_, outFile);
-			outFile.close();
+			out.write(data_out_);
 			++n_;
 			data_out_.clear();
 		}
 
 	private:
-		std::deque<std::array<float, 9>> data_out_; // idx, pos.x, pos.y, dir.x, dir.y, speed, accel.x, accel.y
-		static const size_t n_param_ = 9; // number of parameters to save in timeseries
+		static constexpr row_schema<8> columns_ = { "id", "posx", "posy", "dirx", "diry", "speed", "accelx", "accely" };
+		row_arena data_out_;
 		std::filesystem::path full_out_path_;
 		size_t n_; // number of snapshots taken
-		std::ofstream outfile_stream_;
 	};
 
 
@@ -214,11 +243,24 @@ namespace analysis
 	class AllNeighborsObserver : public model::AnalysisObserver
 	{
 	public:
+		// optional: "k" nearest neighbors (default all), "max_dist" [m] (default none),
+		// "layout": "wide" (one row per individual, default) or "long" (one row per neighbor)
 		AllNeighborsObserver(const std::filesystem::path& out_path, const json& J, const size_t& N)
 			: AnalysisObserver(out_path, J)
 		{	
+			k_ = std::min(J.value("k", N), N ? N - 1 : 0);    // no neighbors without individuals
+			const float max_dist = J.value("max_dist", std::numeric_limits<float>::infinity());
+			max_dist2_ = max_dist * max_dist;
+			const std::string layout = J.value("layout", "wide");
+			if (layout != "wide" && layout != "long") throw std::runtime_error("unknown NeighbData layout '" + layout + "'");
+			long_ = (layout == "long");
+			if (long_)
+			{
+				open_table(header_of(long_columns_));
+				return;
+			}
 			std::string header = "time,id,flock_id";
-			for (auto i = 1; i < N; ++i)
+			for (size_t i = 1; i <= k_; ++i)
 			{
 				header += ",idOfn" + std::to_string(i);
 				header += ",dist2n" + std::to_string(i);
@@ -226,41 +268,74 @@ namespace analysis
 				header += ",dirX2n" + std::to_string(i);
 				header += ",dirY2n" + std::to_string(i);
 			}
-			analysis::open_csv(outfile_stream_, full_out_path_, header);
+			open_table(header);
 		}
 
 		~AllNeighborsObserver() override {}
 
-		void notify_collect(const model::Simulation& sim) override
+		void notify_init(const model::Simulation& sim) override
 		{
-			const auto& flock = sim.pop<Tag>();
-			const auto tt = static_cast<float>(sim.tick())* model::Simulation::dt();
+			// neighbors beyond the interaction range or top-K
+			sim.require_view<Tag>(k_, std::sqrt(max_dist2_));
+		}
 
-			sim.visit_all<Tag>([&](auto& p, size_t idx, bool alive) {
-				// csv writing backwards, so vectors backwards from header, new element to be added in front
-				if (alive) {
+		void notify_collect(const model::Simulation& sim) override { collect(sim); }
+		void notify_collect(const model::tick_sample& smp) override { collect(smp); }
+		bool async_collect() const noexcept override { return true; }
 
-					data_out_.push_back(std::vector<float>());
-					const auto& all_nb = sim.sorted_view<Tag>(idx); // all neighbors
+		template <typename Src>
+		void collect(const Src& sim)
+		{
+			const auto& flock = sim.template pop<Tag>();
+			const auto tt = static_cast<float>(sim.tick())* model::Simulation::dt();
 
-					if (all_nb.size())
-					{
-						for (auto it = all_nb.cend() - 1; it != all_nb.cbegin() - 1; --it) { // reverting iterator cause of csv saving function
-							auto dir2 = math::save_normalize(torus::ofs(sim.WH(), p.pos, flock[it->idx].pos), vec_t(0.f));
-							data_out_.back().insert(data_out_.back().end(), { dir2.y, dir2.x, it->bangl, std::sqrt(it->dist2), static_cast<float>(it->idx) });
+			sim.template visit_all<Tag>([&](auto& p, size_t idx, bool alive) {
+				if (alive) {
+					const auto id = static_cast<float>(sim.template id<Tag>(idx));
+					const auto fid = static_cast<float>(sim.template flock_info<Tag>(sim.template flock_of<Tag>(idx)).id);
+					float* row = nullptr;
+					float* end = nullptr;
+					if (!long_) {
+						row = data_out_.push_row();
+						end = row + data_out_.n_cols();
+						*row++ = tt;
+						*row++ = id;
+						*row++ = fid;
+					}
+					const auto& nb = sim.template observed_view<Tag>(idx); // sorted by distance
+					size_t n = 0;
+					for (auto it = nb.cbegin(); it != nb.cend() && n < k_ && it->dist2 <= max_dist2_; ++it) {
+						const auto dir2 = math::save_normalize(torus::ofs(sim.WH(), p.pos(), flock[it->idx].pos()), vec_t(0.f));
+						const auto nb_id = sim.template id<Tag>(it->idx);
+						++n;
+						if (long_) {
+							data_out_.push(long_columns_, tt, id, fid, n, nb_id, std::sqrt(it->dist2), it->bangl, dir2.x, dir2.y);
+						}
+						else {
+							*row++ = static_cast<float>(nb_id);
+							*row++ = std::sqrt(it->dist2);
+							*row++ = it->bangl;
+							*row++ = dir2.x;
+							*row++ = dir2.y;
 						}
 					}
-					data_out_.back().insert(data_out_.back().end(), { static_cast<float>(sim.flock_of<Tag>(idx)), static_cast<float>(idx), tt });
+					if (!long_) std::fill(row, end, std::numeric_limits<float>::quiet_NaN());   // missing neighbors
 				}
 			});
 		}
 
-		void notify_save(const model::Simulation& sim) override
+		void export_rows(const rows_t& rows) override
 		{
-			if (data_out_.empty()) { return; }
+			if (rows.empty()) { return; }
 			std::cout << "Saving neighbors data.." << std::endl;
-			analysis::export_data(data_out_, outfile_stream_);
+			out_.write(rows);
 		}
+
+	private:
+		static constexpr row_schema<9> long_columns_ = { "time", "id", "flock_id", "n", "idOfn", "dist2n", "bAngl2n", "dirX2n", "dirY2n" };
+		size_t k_;
+		float max_dist2_;
+		bool long_;
 	};
 
 
@@ -271,31 +346,35 @@ namespace analysis
 		ForcesObserver(const std::filesystem::path& out_path, const json& J)
 			: AnalysisObserver(out_path, J)
 		{
-			analysis::open_csv(outfile_stream_, full_out_path_, header_);
+			open_table(header_of(columns_));
 		}
 		~ForcesObserver() override {}
 
-		void notify_collect(const model::Simulation& sim) override
+		void notify_collect(const model::Simulation& sim) override { collect(sim); }
+		void notify_collect(const model::tick_sample& smp) override { collect(smp); }
+		bool async_collect() const noexcept override { return true; }
+
+		template <typename Src>
+		void collect(const Src& sim)
 		{
 			const auto tt = static_cast<float>(sim.tick())* model::Simulation::dt();
 
-			sim.visit_all<Tag>([&](auto& p, size_t idx, bool alive) {
-				// csv writing backwards, so vectors backwards from header, new element to be added in front
+			sim.template visit_all<Tag>([&](auto& p, size_t idx, bool alive) {
 				if (alive) {
-					data_out_.push_back({ p.f_sep_ang , p.f_coh_ang, p.f_ali_ang, static_cast<float>(idx), tt });
+					data_out_.push(columns_, tt, sim.template id<Tag>(idx), p.f_ali_ang, p.f_coh_ang, p.f_sep_ang);
 				}
 				});
 		}
 
-		void notify_save(const model::Simulation& sim) override
+		void export_rows(const rows_t& rows) override
 		{
-			if (data_out_.empty()) { return; }
+			if (rows.empty()) { return; }
 			std::cout << "Saving forces data.." << std::endl;
-			analysis::export_data(data_out_, outfile_stream_);
+			out_.write(rows);
 		}
 
 	private:
-		const std::string header_ = "time,id,ali_angl,coh_angl,sep_angl";
+		static constexpr row_schema<5> columns_ = { "time", "id", "ali_angl", "coh_angl", "sep_angl" };
 	};
 
 
@@ -312,21 +391,36 @@ namespace analysis
 			std::cout << "No analysis observers created, data extraction will not take place." << std::endl; 
 			return res; // no observers created
 		}
-		const auto unique_path = analysis::unique_output_folder(ja);
+		// ensemble runs write into a given sub folder of data_folder
+		const auto unique_path = ja.contains("run_folder")
+			? analysis::run_output_folder(ja)
+			: analysis::unique_output_folder(ja);
 
 		// inject output path to json object
 		ja["output_path"] = unique_path.string();
 
+		// optional asynchronous collection, at most 'async' samples in flight
+		const size_t async = ja.value("async", 0);
+		auto pipeline = async ? std::make_shared<observer_pipeline>(async) : nullptr;
+
 		const auto& jo = ja["Observers"];
+
+		// shared output thread, one buffer in the queue per observer while the next one fills
+		auto writer = std::make_shared<background_writer>(jo.size());
 		for (const auto& j : jo)
 		{
 			std::string type = j["type"];
 			if (type == "TimeSeries") res.emplace_back(std::make_unique<TimeSeriesObserver<Tag>>(unique_path, j));
 			else if (type == "FlockData") res.emplace_back(std::make_unique<FlockObserver<Tag>>(unique_path, j));
+			else if (type == "FlockEvents") res.emplace_back(std::make_unique<FlockEventsObserver<Tag>>(unique_path, j));
 			else if (type == "NeighbData") res.emplace_back(std::make_unique<AllNeighborsObserver<Tag>>(unique_path, j, N));
 			else if (type == "SnapShot") res.emplace_back(std::make_unique<SnapShotObserver<Tag>>(unique_path, j));
 			else if (type == "CoordForces") res.emplace_back(std::make_unique<ForcesObserver<Tag>>(unique_path, j));
 			else throw std::runtime_error("unknown observer");
+			if (auto ao = dynamic_cast<AnalysisObserver*>(res.back().get())) {
+				ao->set_pipeline(pipeline);
+				ao->set_writer(writer);
+			}
 		}
 		res.emplace_back(std::make_unique<DataExpObserver>(J)); // has to be at the end of the chain
 		return res;
@@ -0,0 +1,355 @@
+#ifndef ANALYSIS_TABLE_IO_HPP_INCLUDED
+#define ANALYSIS_TABLE_IO_HPP_INCLUDED
+
+#include <array>
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+
+
+// Output tables of the analysis observers.
+// Standalone (std only), thus usable from external tools.
+//
+// Columnar format (.pcol), native little endian:
+//   magic       char[8]  "PGNCOL\0\1"
+//   n_cols      uint32
+//   n_cols x    { uint8 type, uint8 0, uint16 name length, char name[] }
+//   chunks      { uint32 n_rows, n_cols x n_rows values of the column type }
+// Missing values (e.g. less neighbors than columns) are NaN, empty fields in csv.
+namespace analysis
+{
+	// compile-time row layout of an observer: the column names
+	template <size_t N>
+	using row_schema = std::array<const char*, N>;
+
+	template <size_t N>
+	inline std::string header_of(const row_schema<N>& schema)
+	{
+		std::string header;
+		for (auto name : schema) {
+			header += (header.empty() ? "" : ",") + std::string(name);
+		}
+		return header;
+	}
+
+
+	// flat row-major table with a fixed number of columns.
+	// the storage is kept by clear(), thus reused across flushes.
+	class row_arena
+	{
+	public:
+		row_arena() = default;
+		explicit row_arena(size_t n_cols) : n_cols_(n_cols) {}
+
+		// sets the width and preallocates 'rows' rows (at most max_reserve values)
+		void reset(size_t n_cols, size_t rows)
+		{
+			n_cols_ = n_cols;
+			n_rows_ = 0;
+			data_.resize(std::min(rows * n_cols, max_reserve));
+		}
+
+		size_t n_cols() const noexcept { return n_cols_; }
+		size_t size() const noexcept { return n_rows_; }
+		bool empty() const noexcept { return n_rows_ == 0; }
+		void clear() noexcept { n_rows_ = 0; }
+
+		const float* row(size_t r) const noexcept { return data_.data() + r * n_cols_; }
+
+		// appends a row, the values are left unspecified
+		float* push_row()
+		{
+			const auto end = (n_rows_ + 1) * n_cols_;
+			if (end > data_.size()) {
+				data_.resize(std::max(end, 2 * data_.size()));
+			}
+			return data_.data() + (n_rows_++) * n_cols_;
+		}
+
+		// appends a row matching schema
+		template <size_t N, typename... T>
+		void push(const row_schema<N>&, T... vals)
+		{
+			static_assert(sizeof...(T) == N, "row does not match schema");
+			assert(N == n_cols_);
+			auto r = push_row();
+			((*r++ = static_cast<float>(vals)), ...);
+		}
+
+		void swap(row_arena& other) noexcept
+		{
+			std::swap(n_cols_, other.n_cols_);
+			std::swap(n_rows_, other.n_rows_);
+			data_.swap(other.data_);
+		}
+
+	private:
+		static constexpr size_t max_reserve = size_t(1) << 24;
+
+		size_t n_cols_ = 0;
+		size_t n_rows_ = 0;
+		std::vector<float> data_;
+	};
+
+
+	// csv formatting with std::to_chars into a large buffer that is
+	// handed to the stream in one write when full; no per-row flush.
+	// precision: significant digits (as ostream <<, default 6) or
+	// 'shortest' for the shortest round-trip representation.
+	class csv_writer
+	{
+	public:
+		static constexpr int shortest = -1;
+
+		explicit csv_writer(int precision = 6, size_t capacity = size_t(1) << 20)
+			: precision_(precision), capacity_(capacity)
+		{
+		}
+
+		void set_precision(int precision) noexcept { precision_ = precision; }
+
+		// appends one line, NaN as empty field
+		void row(std::ostream& os, const float* row, size_t n_cols)
+		{
+			const size_t max_line = n_cols * max_field();
+			if (pos_ + max_line > buf_.size()) {
+				flush(os);
+				buf_.resize(std::max(max_line, capacity_));
+			}
+			char* p = buf_.data() + pos_;
+			char* const last = buf_.data() + buf_.size();
+			for (size_t c = 0; c < n_cols; ++c) {
+				if (c) *p++ = ',';
+				if (!std::isnan(row[c])) {
+					p = (precision_ < 0)
+						? std::to_chars(p, last, row[c]).ptr
+						: std::to_chars(p, last, row[c], std::chars_format::general, precision_).ptr;
+				}
+			}
+			*p++ = '\n';
+			pos_ = static_cast<size_t>(p - buf_.data());
+		}
+
+		void flush(std::ostream& os)
+		{
+			os.write(buf_.data(), pos_);
+			pos_ = 0;
+		}
+
+	private:
+		// sign, digits, '.', exponent and ','
+		size_t max_field() const noexcept
+		{
+			return static_cast<size_t>(std::max(precision_, 9)) + 10;
+		}
+
+		int precision_;
+		size_t capacity_;
+		std::vector<char> buf_;           // allocated on first use
+		size_t pos_ = 0;
+	};
+
+	inline int parse_csv_precision(const std::string& name)
+	{
+		if (name == "shortest") return csv_writer::shortest;
+		throw std::runtime_error("unknown csv precision '" + name + "'");
+	}
+
+	enum class table_format { csv, columnar };
+
+	inline table_format parse_table_format(const std::string& name)
+	{
+		if (name == "csv") return table_format::csv;
+		if (name == "columnar") return table_format::columnar;
+		throw std::runtime_error("unknown output format '" + name + "'");
+	}
+
+	inline const char* table_extension(table_format fmt)
+	{
+		return (fmt == table_format::csv) ? ".csv" : ".pcol";
+	}
+
+
+	namespace columnar
+	{
+		constexpr char magic[8] = { 'P', 'G', 'N', 'C', 'O', 'L', '\0', '\1' };
+
+		enum column_type : uint8_t { f32 = 1 };
+
+		inline std::vector<std::string> split_header(const std::string& header)
+		{
+			std::vector<std::string> names(1);
+			for (auto c : header) {
+				if (c == ',') names.emplace_back();
+				else names.back().push_back(c);
+			}
+			return names;
+		}
+
+		template <typename T>
+		inline void put(std::ostream& os, T val)
+		{
+			os.write(reinterpret_cast<const char*>(&val), sizeof(T));
+		}
+
+		template <typename T>
+		inline bool get(std::istream& is, T& val)
+		{
+			return static_cast<bool>(is.read(reinterpret_cast<char*>(&val), sizeof(T)));
+		}
+
+		inline void write_header(std::ostream& os, const std::vector<std::string>& names)
+		{
+			os.write(magic, sizeof(magic));
+			put(os, static_cast<uint32_t>(names.size()));
+			for (const auto& name : names) {
+				put(os, static_cast<uint8_t>(f32));
+				put(os, uint8_t(0));
+				put(os, static_cast<uint16_t>(name.size()));
+				os.write(name.data(), name.size());
+			}
+		}
+
+		// writes one chunk, transposes the rows
+		inline void write_chunk(std::ostream& os, const row_arena& rows, std::vector<float>& col)
+		{
+			const auto n_rows = rows.size();
+			put(os, static_cast<uint32_t>(n_rows));
+			col.resize(n_rows);
+			for (size_t c = 0; c < rows.n_cols(); ++c) {
+				for (size_t r = 0; r < n_rows; ++r) {
+					col[r] = rows.row(r)[c];
+				}
+				os.write(reinterpret_cast<const char*>(col.data()), n_rows * sizeof(float));
+			}
+		}
+
+
+		// sequential chunk reader
+		class reader
+		{
+		public:
+			explicit reader(const std::string& path) : is_(path, std::ios::binary)
+			{
+				char m[sizeof(magic)];
+				if (!is_.read(m, sizeof(m)) || std::memcmp(m, magic, sizeof(magic))) {
+					throw std::runtime_error("'" + path + "' is not a columnar table");
+				}
+				uint32_t n_cols = 0;
+				get(is_, n_cols);
+				names_.resize(n_cols);
+				for (auto& name : names_) {
+					uint8_t type = 0, pad = 0;
+					uint16_t len = 0;
+					get(is_, type); get(is_, pad); get(is_, len);
+					if (type != f32) throw std::runtime_error("unsupported column type in '" + path + "'");
+					name.resize(len);
+					is_.read(name.data(), len);
+				}
+				if (!is_) throw std::runtime_error("truncated header in '" + path + "'");
+			}
+
+			const std::vector<std::string>& names() const noexcept { return names_; }
+
+			// reads the next chunk into cols[column][row], false at end of file
+			bool next_chunk(std::vector<std::vector<float>>& cols)
+			{
+				uint32_t n_rows = 0;
+				if (!get(is_, n_rows)) return false;
+				cols.resize(names_.size());
+				for (auto& col : cols) {
+					col.resize(n_rows);
+					if (!is_.read(reinterpret_cast<char*>(col.data()), n_rows * sizeof(float))) {
+						throw std::runtime_error("truncated chunk");
+					}
+				}
+				return true;
+			}
+
+		private:
+			std::ifstream is_;
+			std::vector<std::string> names_;
+		};
+
+
+		// converts a columnar table to csv
+		inline void to_csv(const std::string& in_path, std::ostream& os, int precision = 6)
+		{
+			reader rd(in_path);
+			const auto& names = rd.names();
+			for (size_t c = 0; c < names.size(); ++c) {
+				os << names[c] << ((c + 1 < names.size()) ? ',' : '\n');
+			}
+			std::vector<std::vector<float>> cols;
+			std::vector<float> row(names.size());
+			csv_writer csv(precision);
+			while (rd.next_chunk(cols)) {
+				const auto n_rows = cols.empty() ? 0 : cols[0].size();
+				for (size_t r = 0; r < n_rows; ++r) {
+					for (size_t c = 0; c < cols.size(); ++c) row[c] = cols[c][r];
+					csv.row(os, row.data(), row.size());
+				}
+			}
+			csv.flush(os);
+		}
+	}
+
+
+	// output table of one observer
+	class table_stream
+	{
+	public:
+		table_stream() = default;
+
+		void open(const std::string& full_path, const std::string& header, table_format fmt, int precision = 6)
+		{
+			fmt_ = fmt;
+			csv_.set_precision(precision);
+			const auto names = columnar::split_header(header);
+			n_cols_ = names.size();
+			if (fmt_ == table_format::csv) {
+				os_.open(full_path);
+				os_ << header << std::endl;
+			}
+			else {
+				os_.open(full_path, std::ios::binary);
+				columnar::write_header(os_, names);
+			}
+			if (!os_) throw std::runtime_error("can't create '" + full_path + "'");
+		}
+
+		size_t n_cols() const noexcept { return n_cols_; }
+
+		// appends rows
+		void write(const row_arena& rows)
+		{
+			assert(rows.n_cols() == n_cols_);
+			if (fmt_ == table_format::csv) {
+				for (size_t r = 0; r < rows.size(); ++r) {
+					csv_.row(os_, rows.row(r), n_cols_);
+				}
+				csv_.flush(os_);
+			}
+			else {
+				columnar::write_chunk(os_, rows, col_);
+			}
+		}
+
+	private:
+		table_format fmt_ = table_format::csv;
+		size_t n_cols_ = 0;
+		std::ofstream os_;
+		std::vector<float> col_;    // column scratch
+		csv_writer csv_;
+	};
+}
+
+#endif
@@ -7,6 +7,8 @@
 #include <vector>
 #include <stack>
 #include <queue>
+#include <atomic>
+#include <memory>
 #include <tbb/tbb.h>
 //#include <ppl.h>
 
@@ -132,6 +134,49 @@ namespace graph {
   }
 
 
+  // lock-free disjoint set, unite & find may be called concurrently.
+  // the root of a set is its smallest element.
+  class concurrent_union_find
+  {
+  public:
+    explicit concurrent_union_find(size_t n) : n_(n), parent_(new std::atomic<unsigned>[n])
+    {
+      for (size_t i = 0; i < n; ++i) parent_[i].store(static_cast<unsigned>(i), std::memory_order_relaxed);
+    }
+
+    size_t size() const noexcept { return n_; }
+
+    unsigned find(unsigned x) const noexcept
+    {
+      for (;;)
+      {
+        auto p = parent_[x].load(std::memory_order_relaxed);
+        if (p == x) return x;
+        const auto gp = parent_[p].load(std::memory_order_relaxed);
+        if (p != gp) parent_[x].compare_exchange_weak(p, gp, std::memory_order_relaxed);   // path halving
+        x = gp;
+      }
+    }
+
+    void unite(unsigned a, unsigned b) noexcept
+    {
+      for (;;)
+      {
+        a = find(a);
+        b = find(b);
+        if (a == b) return;
+        if (a < b) std::swap(a, b);
+        auto expected = a;
+        if (parent_[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) return;
+      }
+    }
+
+  private:
+    size_t n_;
+    std::unique_ptr<std::atomic<unsigned>[]> parent_;
+  };
+
+
   template <typename IT, typename IT1, typename Pred>
   bool are_connected(IT first, IT last, IT1 first1, IT1 last1, Pred pred)
   {
@@ -1,7 +1,12 @@
 #ifndef MODEL_ACTIONS_ACTION_BASE_HPP_INCLUDED
 #define MODEL_ACTIONS_ACTION_BASE_HPP_INCLUDED
 
+#include <array>
+#include <tuple>
+#include <utility>
+#include <type_traits>
 #include "simulation.hpp"
+#include "perception.hpp"
 
 
 namespace model {
@@ -22,6 +27,109 @@ namespace model {
     *
     */
 
+   /*
+    *  an action that only sums over the perceived neighbors may declare
+    *  itself as neighbor reducer:
+    *
+    *      static constexpr bool neighbor_reducer = true;
+    *      struct accumulator;
+    *      int topo;
+    *      bool reduce(accumulator& acc, const percept& p, const agent_type* self, const Pop& flock) const;
+    *      void apply(agent_type* self, const accumulator& acc, size_t realized_topo);
+    *
+    *  reduce returns true if p counts towards topo (see perception::while_topo).
+    *  The reducers of a state share a single pass over the perception.
+    */
+
+    template <typename Action, typename = void>
+    struct is_neighbor_reducer : std::false_type {};
+
+    template <typename Action>
+    struct is_neighbor_reducer<Action, std::enable_if_t<Action::neighbor_reducer>> : std::true_type {};
+
+    template <typename Action, bool = is_neighbor_reducer<Action>::value>
+    struct reducer_accumulator { struct type {}; };
+
+    template <typename Action>
+    struct reducer_accumulator<Action, true> { using type = typename Action::accumulator; };
+
+
+    // fused evaluation of the neighbor reducers in ActionTuple
+    template <typename ActionTuple>
+    class fused_pass
+    {
+      static constexpr size_t size = std::tuple_size_v<ActionTuple>;
+      using seq = std::make_index_sequence<size>;
+
+      template <typename T> struct accumulators;
+      template <typename ... Actions>
+      struct accumulators<std::tuple<Actions...>> { using type = std::tuple<typename reducer_accumulator<Actions>::type...>; };
+
+    public:
+      template <typename Agent>
+      fused_pass(const ActionTuple& actions, const Agent* self, const Simulation& sim)
+      {
+        init(actions, seq{});
+        if (pending_ == 0) return;
+        const auto& flock = sim.pop<typename Agent::Tag>();
+        perception<Agent>::visit(self, [&](const percept& p) {
+          reduce(actions, p, self, flock, seq{});
+          return pending_ != 0;
+        });
+      }
+
+      // applies action I, either from the fused pass or by calling it
+      template <size_t I, typename Agent>
+      void invoke(ActionTuple& actions, Agent* self, size_t idx, tick_t T, const Simulation& sim)
+      {
+        auto& action = std::get<I>(actions);
+        if constexpr (is_neighbor_reducer<std::tuple_element_t<I, ActionTuple>>::value) {
+          action.apply(self, std::get<I>(acc_), topo_[I] - left_[I]);
+        }
+        else {
+          action(self, idx, T, sim);
+        }
+      }
+
+    private:
+      template <size_t ... Is>
+      void init(const ActionTuple& actions, std::index_sequence<Is...>)
+      {
+        (init_one<Is>(actions), ...);
+      }
+
+      template <size_t I>
+      void init_one(const ActionTuple& actions)
+      {
+        if constexpr (is_neighbor_reducer<std::tuple_element_t<I, ActionTuple>>::value) {
+          topo_[I] = left_[I] = static_cast<size_t>(std::get<I>(actions).topo);
+          if (left_[I]) ++pending_;
+        }
+      }
+
+      template <typename Agent, typename Pop, size_t ... Is>
+      void reduce(const ActionTuple& actions, const percept& p, const Agent* self, const Pop& flock, std::index_sequence<Is...>)
+      {
+        (reduce_one<Is>(actions, p, self, flock), ...);
+      }
+
+      template <size_t I, typename Agent, typename Pop>
+      void reduce_one(const ActionTuple& actions, const percept& p, const Agent* self, const Pop& flock)
+      {
+        if constexpr (is_neighbor_reducer<std::tuple_element_t<I, ActionTuple>>::value) {
+          if (left_[I] && std::get<I>(actions).reduce(std::get<I>(acc_), p, self, flock)) {
+            if (--left_[I] == 0) --pending_;
+          }
+        }
+      }
+
+      typename accumulators<ActionTuple>::type acc_;
+      std::array<size_t, size> topo_ = {};
+      std::array<size_t, size> left_ = {};    // topo left
+      size_t pending_ = 0;                    // reducers with topo left
+    };
+
+
     template <typename Agent, typename ... Actions>
     class package
     {
@@ -0,0 +1,81 @@
+#ifndef MODEL_BACKGROUND_WRITER_HPP_INCLUDED
+#define MODEL_BACKGROUND_WRITER_HPP_INCLUDED
+
+#include <thread>
+#include <algorithm>
+#include <utility>
+#include <future>
+#include <exception>
+#include <functional>
+#include <tbb/concurrent_queue.h>
+#include "trace.hpp"
+
+
+namespace model {
+
+
+  // dedicated output thread.
+  // observers hand their full buffers over as write jobs and continue
+  // with a fresh buffer. Jobs run in submission order. Producers only
+  // block if 'capacity' jobs are pending (backpressure).
+  class background_writer
+  {
+  public:
+    using job_fun = std::function<void()>;
+
+    explicit background_writer(size_t capacity)
+    {
+      queue_.set_capacity(static_cast<std::ptrdiff_t>(std::max(capacity, size_t(1))));
+      thread_ = std::thread([this]() { run(); });
+    }
+
+    ~background_writer()
+    {
+      queue_.push(job_fun{});     // stop token, after all pending jobs
+      thread_.join();
+    }
+
+    // thread safe
+    void submit(job_fun fun)
+    {
+      queue_.push(std::move(fun));
+    }
+
+    // blocks until all jobs submitted so far are written.
+    // rethrows the first exception thrown by a job.
+    void wait()
+    {
+      std::promise<void> done;
+      auto future = done.get_future();
+      queue_.push([&done]() { done.set_value(); });
+      future.get();
+      if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+      }
+    }
+
+  private:
+    void run()
+    {
+      trace::name_thread("writer");
+      job_fun fun;
+      for (;;) {
+        queue_.pop(fun);
+        if (!fun) break;
+        try {
+          fun();
+        }
+        catch (...) {
+          if (!error_) error_ = std::current_exception();
+        }
+      }
+    }
+
+    tbb::concurrent_bounded_queue<job_fun> queue_;
+    std::exception_ptr error_;      // published by the wait job
+    std::thread thread_;
+  };
+
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include <queue>
 #include <algorithm>
+#include <numeric>
+#include <tbb/tbb.h>
 #include <libs/torus.hpp>
 #include <libs/graph.hpp>
 #include <glmutils/oobb.hpp>
@@ -8,32 +10,247 @@
 
 namespace model {
 
-  void flock_tracker::cluster(float dd)
+  void flock_tracker::cluster(float dd, tick_t T)
   {
+    prev_id_.swap(flock_id_);
+    if (prev_id_.size() != proxy_.size()) prev_id_.assign(proxy_.size(), no_flock);
+    prev_pid_.resize(descr_.size());
+    std::transform(descr_.cbegin(), descr_.cend(), prev_pid_.begin(), [](const auto& fd) { return fd.id; });
     flock_id_.assign(proxy_.size(), no_flock);
     auto last = std::partition(proxy_.begin(), proxy_.end(), [](const auto& ipv) { return ipv.idx != static_cast<unsigned>(-1); });
     proxy_.erase(last, proxy_.end());
+    grid_.reset(Simulation::WH(), std::sqrt(dd));
+    if (grid_.active()) {
+      freeze(dd);
+      grid_components(dd);
+    }
+    else {
+      connected_components(dd);
+      group_.clear();
+    }
+    describe();
+    identify(T);
+  }
+
+
+  // O(n^2), for thresholds in the order of WH
+  void flock_tracker::connected_components(float dd)
+  {
     const auto n = proxy_.size();
     auto cc = graph::connected_components(0, static_cast<int>(n), [&](int i, int j) {
       return dd > torus::distance2(Simulation::WH(), proxy_[i].pos, proxy_[j].pos);
     });
-    descr_.clear();
-    std::vector<vec_t> vpos;
-    for (unsigned ci = 0; ci < static_cast<unsigned>(cc.size()); ++ci) {
-      vpos.clear();
-      vec_t vel = vec_t(0);
-      for (auto i : cc[ci]) {
-        flock_id_[proxy_[i].idx] = ci;
-        vpos.emplace_back(torus::ofs(Simulation::WH(), proxy_[cc[ci][0]].pos, proxy_[i].pos));
-        vel += proxy_[i].vel;
-      }
-      vec_t ext;
-      auto H = glmutils::oobb(static_cast<int>(cc[ci].size()), vpos.begin(), ext);
-      vel /= cc[ci].size();
-      //auto dir = glm::normalize(vel);
-      H[2] = glm::vec3(torus::wrap(Simulation::WH(), vec_t(H[2]) + proxy_[cc[ci][0]].pos), 1.f);
-      descr_.push_back({ vpos.size(), vel, H, ext });
-      int x = 0;
+    comp_start_.assign(1, 0);
+    comp_.clear();
+    for (const auto& c : cc) {
+      comp_.insert(comp_.end(), c.cbegin(), c.cend());
+      comp_start_.push_back(static_cast<unsigned>(comp_.size()));
+    }
+  }
+
+
+  // a group of the last clustering is frozen if it lost no member and
+  // no member moved more than 0.15 threshold relative to the group.
+  // groups are connected by links shorter than 0.7 threshold at their
+  // reference positions, thus their links are still shorter than the threshold.
+  void flock_tracker::freeze(float dd)
+  {
+    const auto n = static_cast<unsigned>(proxy_.size());
+    const auto ng = group_size_.size();
+    frozen_.assign(n, no_flock);
+    if (group_.size() != prev_id_.size()) return;
+    std::vector<vec_t> drift(ng, vec_t(0));
+    std::vector<unsigned> count(ng, 0);
+    std::vector<unsigned> rep(ng, no_flock);
+    for (unsigned i = 0; i < n; ++i) {
+      const auto g = group_[proxy_[i].idx];
+      if (g == no_flock) continue;    // revived
+      drift[g] += torus::ofs(Simulation::WH(), ref_[proxy_[i].idx], proxy_[i].pos);
+      if (count[g]++ == 0) rep[g] = i;
+    }
+    std::vector<char> frozen(ng, false);
+    for (size_t g = 0; g < ng; ++g) {
+      frozen[g] = (count[g] == group_size_[g]) && (count[g] > 1);   // singletons may join others
+      if (frozen[g]) drift[g] /= static_cast<float>(count[g]);
+    }
+    const auto maxdev2 = 0.15f * 0.15f * dd;
+    for (unsigned i = 0; i < n; ++i) {
+      const auto g = group_[proxy_[i].idx];
+      if (g == no_flock || !frozen[g]) continue;
+      const auto dev = torus::ofs(Simulation::WH(), ref_[proxy_[i].idx], proxy_[i].pos) - drift[g];
+      if (glm::dot(dev, dev) > maxdev2) frozen[g] = false;
+    }
+    for (unsigned i = 0; i < n; ++i) {
+      const auto g = group_[proxy_[i].idx];
+      if (g != no_flock && frozen[g]) frozen_[i] = rep[g];
+    }
+  }
+
+
+  // cell list with cells of threshold width, concurrent union-find
+  // over pairs in adjacent cells. Pairs within the same frozen group
+  // are not tested, their members are united with the representative.
+  // A second union-find over links shorter than 0.7 threshold between
+  // the other individuals forms the new groups.
+  void flock_tracker::grid_components(float dd)
+  {
+    const auto n = static_cast<unsigned>(proxy_.size());
+    const auto sdd = 0.7f * 0.7f * dd;
+    grid_.build(proxy_);
+    graph::concurrent_union_find uf(n);
+    graph::concurrent_union_find suf(n);
+    tbb::parallel_for(tbb::blocked_range<unsigned>(0, n, 256), [&](const auto& r) {
+      for (auto i = r.begin(); i < r.end(); ++i) {
+        const auto pos = proxy_[i].pos;
+        const auto fi = frozen_[i];
+        if (fi != no_flock) uf.unite(i, fi);
+        grid_.visit(pos, [&](unsigned j) {
+          if (j > i && (fi == no_flock || fi != frozen_[j])) {
+            const auto d2 = torus::distance2(Simulation::WH(), pos, proxy_[j].pos);
+            if (dd > d2) {
+              uf.unite(i, j);
+              if (sdd > d2 && fi == no_flock && frozen_[j] == no_flock) suf.unite(i, j);
+            }
+          }
+        });
+      }
+    });
+    // components ordered by their first proxy, members in proxy order
+    std::vector<unsigned> label(n, no_flock);
+    comp_start_.assign(1, 0);
+    for (unsigned i = 0; i < n; ++i) {
+      const auto root = uf.find(i);   // root <= i
+      if (root == i) {
+        label[i] = static_cast<unsigned>(comp_start_.size() - 1);
+        comp_start_.push_back(0);
+      }
+      label[i] = label[root];
+      ++comp_start_[label[i] + 1];
+    }
+    std::partial_sum(comp_start_.begin(), comp_start_.end(), comp_start_.begin());
+    comp_.resize(n);
+    std::vector<unsigned> fill(comp_start_.cbegin(), comp_start_.cend() - 1);
+    for (unsigned i = 0; i < n; ++i) {
+      comp_[fill[label[i]]++] = i;
+    }
+    // frozen groups continue with their reference, the other individuals
+    // are grouped by strong links and take their current position as reference
+    std::vector<unsigned> glabel(n, no_flock);
+    group_.assign(prev_id_.size(), no_flock);
+    group_size_.clear();
+    ref_.resize(prev_id_.size());
+    for (unsigned i = 0; i < n; ++i) {
+      const auto idx = proxy_[i].idx;
+      const auto key = (frozen_[i] != no_flock) ? frozen_[i] : suf.find(i);
+      if (glabel[key] == no_flock) {
+        glabel[key] = static_cast<unsigned>(group_size_.size());
+        group_size_.push_back(0);
+      }
+      group_[idx] = glabel[key];
+      ++group_size_[glabel[key]];
+      if (frozen_[i] == no_flock) ref_[idx] = proxy_[i].pos;
+    }
+  }
+
+
+  void flock_tracker::describe()
+  {
+    const auto nc = comp_start_.size() - 1;
+    descr_.resize(nc);
+    members_.resize(comp_.size());
+    sums_tick_ = static_cast<tick_t>(-1);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, nc), [&](const auto& r) {
+      std::vector<vec_t> vpos;
+      for (auto ci = r.begin(); ci < r.end(); ++ci) {
+        const auto first = comp_.cbegin() + comp_start_[ci];
+        const auto last = comp_.cbegin() + comp_start_[ci + 1];
+        const auto& anchor = proxy_[*first];
+        vpos.clear();
+        vec_t vel = vec_t(0);
+        for (auto it = first; it != last; ++it) {
+          flock_id_[proxy_[*it].idx] = static_cast<unsigned>(ci);
+          members_[std::distance(comp_.cbegin(), it)] = proxy_[*it].idx;
+          vpos.emplace_back(torus::ofs(Simulation::WH(), anchor.pos, proxy_[*it].pos));
+          vel += proxy_[*it].vel;
+        }
+        vec_t ext;
+        auto H = glmutils::oobb(static_cast<int>(vpos.size()), vpos.begin(), ext);
+        vel /= vpos.size();
+        H[2] = glm::vec3(torus::wrap(Simulation::WH(), vec_t(H[2]) + anchor.pos), 1.f);
+        descr_[ci] = { vpos.size(), vel, H, ext };
+      }
+    });
+  }
+
+
+  // persistent ids: a flock of the last clustering passes its id on to
+  // the new flock if they are each other's largest overlap (ties to the
+  // lower index). Every other overlap is reported as event.
+  void flock_tracker::identify(tick_t T)
+  {
+    const auto nc = descr_.size();
+    const auto np = prev_pid_.size();
+    std::vector<std::pair<unsigned, unsigned>> pk;   // (previous, new) flock of individual
+    for (const auto& p : proxy_) {
+      const auto pf = prev_id_[p.idx];
+      if (pf != no_flock) pk.emplace_back(pf, flock_id_[p.idx]);
+    }
+    std::sort(pk.begin(), pk.end());
+    struct overlap { unsigned p, k, n; };
+    std::vector<overlap> ov;
+    for (const auto& e : pk) {
+      if (ov.empty() || ov.back().p != e.first || ov.back().k != e.second) ov.push_back({ e.first, e.second, 0 });
+      ++ov.back().n;
+    }
+    std::vector<overlap> best_k(np, { no_flock, no_flock, 0 });
+    std::vector<overlap> best_p(nc, { no_flock, no_flock, 0 });
+    for (const auto& o : ov) {
+      if (o.n > best_k[o.p].n) best_k[o.p] = o;
+      if (o.n > best_p[o.k].n) best_p[o.k] = o;
+    }
+    std::vector<char> lives(np, false);
+    for (size_t k = 0; k < nc; ++k) {
+      const auto p = best_p[k].p;
+      if (p != no_flock && best_k[p].k == k) {
+        descr_[k].id = prev_pid_[p];
+        lives[p] = true;
+      }
+      else {
+        descr_[k].id = next_id_++;
+      }
+    }
+    events_.clear();
+    for (const auto& o : ov) {
+      if (prev_pid_[o.p] != descr_[o.k].id) {
+        events_.push_back({ T, lives[o.p] ? flock_event::Split : flock_event::Merge, prev_pid_[o.p], descr_[o.k].id });
+      }
+    }
+  }
+
+
+  void flock_tracker::permute(const std::vector<unsigned>& perm)
+  {
+    if (flock_id_.empty()) return;
+    std::vector<unsigned> tmp(perm.size());
+    for (size_t i = 0; i < perm.size(); ++i) {
+      tmp[i] = flock_id_[perm[i]];
+    }
+    flock_id_.swap(tmp);
+    for (size_t i = 0; i < perm.size(); ++i) {
+      tmp[perm[i]] = static_cast<unsigned>(i);   // inverse
+    }
+    for (auto& m : members_) {
+      m = tmp[m];
+    }
+    sums_tick_ = static_cast<tick_t>(-1);
+    if (group_.size() == perm.size()) {
+      std::vector<pos_t> rtmp(perm.size());
+      for (size_t i = 0; i < perm.size(); ++i) {
+        tmp[i] = group_[perm[i]];
+        rtmp[i] = ref_[perm[i]];
+      }
+      group_.swap(tmp);
+      ref_.swap(rtmp);
     }
   }
 
@@ -1,24 +1,75 @@
 #ifndef MODEL_FLOCK_HPP_INCLUDED
 #define MODEL_FLOCK_HPP_INCLUDED
 
+#include <cassert>
 #include <vector>
+#include <torus.hpp>
 #include "model.hpp"
+#include "neighbor_grid.hpp"
 
 
 namespace model {
 
 
+  constexpr unsigned no_flock = static_cast<unsigned>(-1);
+
+
   struct flock_descr
   {
     size_t size = 0;
     vec_t vel = vec_t(0);  // velocity
     glm::mat3x3 H;         // homogeneous transformation matrix flock -> Euclidean
 	vec_t ext;
+    unsigned id = no_flock;   // persistent id
 
     vec_t gc() const { return vec_t(H[2]); }
   };
 
-  constexpr unsigned no_flock = static_cast<unsigned>(-1);
+
+  // membership transfer between two detections
+  struct flock_event
+  {
+    enum kind_t { Split, Merge };
+
+    tick_t tick;
+    kind_t kind;     // Split: 'id' lives on, Merge: 'id' ended
+    unsigned id;     // persistent id of the flock that lost members
+    unsigned other;  // persistent id of the flock that received them
+  };
+
+
+  // individuals of one flock
+  class flock_members_view
+  {
+  public:
+    flock_members_view() : first_(nullptr), n_(0) {}
+    flock_members_view(const unsigned* first, size_t n) : first_(first), n_(n) {}
+
+    const unsigned* begin() const noexcept { return first_; }
+    const unsigned* end() const noexcept { return first_ + n_; }
+    const unsigned* cbegin() const noexcept { return first_; }
+    const unsigned* cend() const noexcept { return first_ + n_; }
+    unsigned operator[](size_t i) const {
+      assert(i < n_);
+      return *(first_ + i);
+    }
+    bool empty() const noexcept { return n_ == 0; }
+    size_t size() const noexcept { return n_; }
+
+  private:
+    const unsigned* first_;
+    const size_t n_;
+  };
+
+
+  // sums over the alive members of a flock at their current positions
+  struct flock_sums
+  {
+    size_t n = 0;            // alive members
+    pos_t anchor = pos_t(0); // position of the first member
+    vec_t ofs = vec_t(0);    // sum of offsets to anchor
+    vec_t vel = vec_t(0);    // sum of velocities
+  };
 
 
   class flock_tracker
@@ -46,37 +97,97 @@ namespace model {
       return flock_id_[idx];
     }
 
+    // members of flock id, individuals that died since the
+    // last clustering included
+    flock_members_view members(size_t id) const noexcept
+    {
+      if (id >= descr_.size()) return {};
+      return { members_.data() + comp_start_[id], comp_start_[id + 1] - comp_start_[id] };
+    }
+
+    // per-flock sums from the kinematic store ks, refreshed at most once per tick
+    template <typename KS, typename UT>
+    const std::vector<flock_sums>& sums(const KS& ks, const UT& update_times, tick_t T, float WH)
+    {
+      if (sums_tick_ != T) {
+        sums_.assign(descr_.size(), flock_sums{});
+        for (size_t f = 0; f < descr_.size(); ++f) {
+          auto& s = sums_[f];
+          for (auto i : members(f)) {
+            if (update_times[i] == static_cast<tick_t>(-1)) continue;
+            if (s.n++ == 0) s.anchor = ks.pos(i);
+            s.ofs += torus::ofs(WH, s.anchor, ks.pos(i));
+            s.vel += ks.speed(i) * ks.dir(i);
+          }
+        }
+        sums_tick_ = T;
+      }
+      return sums_;
+    }
+
     void prepare(size_t n)
     {
       proxy_.assign(n, proxy{});
     }
 
-    template <typename T>
-    void feed(const T& ind, size_t idx)
+    // individual idx of the kinematic store ks
+    template <typename KS>
+    void feed(const KS& ks, size_t idx)
     {
-      proxy_[idx] = proxy(ind, idx);
+      proxy_[idx] = proxy(ks, idx);
     }
 
-    void cluster(float dd);
+    // events of the last clustering
+    const std::vector<flock_event>& events() const noexcept
+    {
+      return events_;
+    }
+
+    void cluster(float dd, tick_t T);
     void track();
 
+    // new individual i is the former individual perm[i]
+    void permute(const std::vector<unsigned>& perm);
+
   private:
     struct proxy 
     { 
       proxy() : idx(static_cast<unsigned>(-1)) {}
 
-      template <typename T>
-      proxy(const T& ind, size_t idx) :
+      template <typename KS>
+      proxy(const KS& ks, size_t idx) :
         idx(static_cast<unsigned>(idx)),
-        pos(ind.pos),
-        vel(ind.speed* ind.dir)
+        pos(ks.pos(idx)),
+        vel(ks.speed(idx) * ks.dir(idx))
       {}
 
       unsigned idx; vec_t pos, vel;
     };
+    void connected_components(float dd);
+    void freeze(float dd);
+    void grid_components(float dd);
+    void describe();
+    void identify(tick_t T);
+
     std::vector<proxy> proxy_;
     std::vector<flock_descr> descr_;
     std::vector<unsigned> flock_id_;
+    std::vector<unsigned> comp_start_;    // first entry of component in comp_
+    std::vector<unsigned> comp_;          // proxies ordered by component
+    std::vector<unsigned> members_;       // individuals ordered by flock, see comp_start_
+    std::vector<flock_sums> sums_;
+    tick_t sums_tick_ = static_cast<tick_t>(-1);
+    torus_grid grid_;                     // cell list over proxies
+
+    // bookkeeping over detections
+    std::vector<unsigned> prev_id_;       // flock of individual, last clustering
+    std::vector<unsigned> prev_pid_;      // persistent id of flock, last clustering
+    std::vector<unsigned> group_;         // strongly linked group of individual
+    std::vector<unsigned> group_size_;
+    std::vector<pos_t> ref_;              // reference position of individual
+    std::vector<unsigned> frozen_;        // representative proxy of frozen group or no_flock
+    std::vector<flock_event> events_;
+    unsigned next_id_ = 0;
   };
 
 }
@@ -0,0 +1,282 @@
+#ifndef MODEL_KINEMATICS_HPP_INCLUDED
+#define MODEL_KINEMATICS_HPP_INCLUDED
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "model.hpp"
+#include "flight.hpp"
+
+
+namespace model {
+
+
+  // kinematic state of a species, owner of the position, heading,
+  // speed, acceleration and steering of its individuals.
+  // One contiguous array per quantity, indexed by individual. The
+  // integrator runs over them in blocks of 8 without touching the
+  // individuals, the neighbor search reads positions from here.
+  // Individuals reach their entries through kinematic_handle.
+  class kinematic_store
+  {
+  public:
+    static constexpr size_t width = 8;    // individuals per block
+
+    kinematic_store() = default;
+
+    void resize(size_t N)
+    {
+      const size_t n = (N + width - 1) & ~(width - 1);
+      pos_.assign(n, pos_t(0));
+      dir_.assign(n, vec_t(1, 0));
+      accel_.assign(n, vec_t(0));
+      steering_.assign(n, vec_t(0));
+      force_.assign(n, vec_t(0));
+      sa_.assign(n, flight::state_aero<float>{ 0.f, 0.f });
+      for (auto* v : { &speed_, &mass_, &min_speed_, &max_speed_, &angc_, &angd_ }) {
+        v->assign(n, 0.f);
+      }
+      size_ = N;
+    }
+
+    size_t size() const noexcept { return size_; }
+    size_t blocks() const noexcept { return pos_.size() / width; }
+
+    // individual idx starts at rest at the origin, heading (1,0)
+    // with cruise speed. ai shall not change afterwards.
+    void reset(size_t idx, const flight::aero_info<float>& ai) noexcept
+    {
+      pos_[idx] = pos_t(0);
+      dir_[idx] = vec_t(1, 0);
+      accel_[idx] = steering_[idx] = force_[idx] = vec_t(0);
+      speed_[idx] = ai.cruiseSpeed;
+      sa_[idx] = { ai.cruiseSpeed, 0.f };   // w until the first state entry
+      mass_[idx] = ai.bodyMass;
+      min_speed_[idx] = ai.minSpeed;
+      max_speed_[idx] = ai.maxSpeed;
+      angc_[idx] = angd_[idx] = 0.f;
+    }
+
+    pos_t& pos(size_t idx) noexcept { return pos_[idx]; }
+    const pos_t& pos(size_t idx) const noexcept { return pos_[idx]; }
+    vec_t& dir(size_t idx) noexcept { return dir_[idx]; }
+    const vec_t& dir(size_t idx) const noexcept { return dir_[idx]; }
+    float& speed(size_t idx) noexcept { return speed_[idx]; }
+    float speed(size_t idx) const noexcept { return speed_[idx]; }
+    vec_t& accel(size_t idx) noexcept { return accel_[idx]; }
+    const vec_t& accel(size_t idx) const noexcept { return accel_[idx]; }
+    vec_t& steering(size_t idx) noexcept { return steering_[idx]; }
+    const vec_t& steering(size_t idx) const noexcept { return steering_[idx]; }
+    vec_t& force(size_t idx) noexcept { return force_[idx]; }
+    const vec_t& force(size_t idx) const noexcept { return force_[idx]; }
+    flight::state_aero<float>& sa(size_t idx) noexcept { return sa_[idx]; }
+    const flight::state_aero<float>& sa(size_t idx) const noexcept { return sa_[idx]; }
+
+    // angular velocity of the last integration step [1/s]
+    float ang_vel(size_t idx) const noexcept
+    {
+      return std::clamp(std::atan2(angc_[idx], angd_[idx]), -3.14159f, 3.14159f) / dt_;
+    }
+
+    // v[i] = v[perm[i]] for all quantities, see Simulation::reorder
+    void permute(const std::vector<unsigned>& perm)
+    {
+      auto apply = [&](auto& v) {
+        auto tmp = v;
+        for (size_t i = 0; i < perm.size(); ++i) tmp[i] = v[perm[i]];
+        v.swap(tmp);
+      };
+      apply(pos_); apply(dir_); apply(accel_); apply(steering_); apply(force_); apply(sa_);
+      apply(speed_); apply(mass_); apply(min_speed_); apply(max_speed_); apply(angc_); apply(angd_);
+    }
+
+    // integrates the alive individuals in [first, last) by one tick,
+    // see integrate1. first shall be a multiple of width.
+    // With AVX2 every block runs through integrate8 with the dead
+    // and the trailing lanes masked, thus the result of an individual
+    // doesn't depend on the partitioning.
+    template <typename UT>
+    void integrate(size_t first, size_t last, const UT& update_times, float dt, float WH) noexcept
+    {
+      dt_ = dt;
+#if defined(__AVX2__)
+      alignas(32) int alive[width];
+      for (size_t i = first; i < last; i += width) {
+        for (size_t j = 0; j < width; ++j) {
+          alive[j] = (i + j < last && update_times[i + j] != static_cast<tick_t>(-1)) ? -1 : 0;
+        }
+        integrate8(i, _mm256_load_si256(reinterpret_cast<const __m256i*>(alive)), dt, WH);
+      }
+      _mm256_zeroupper();   // scalar (SSE) code follows, e.g. libm
+#else
+      for (size_t i = first; i < last; ++i) {
+        if (update_times[i] != static_cast<tick_t>(-1)) {
+          integrate1(i, dt, WH);
+        }
+      }
+#endif
+    }
+
+  private:
+    // the motion model, integrate8 is the same for 8 individuals.
+    // cruise speed control as drag, modified Euler (midpoint) method:
+    //   v(t + dt/2) = v(t) + a(t) dt/2
+    //   r(t + dt) = r(t) + v(t + dt/2) dt
+    //   a(t + dt) = F(t + dt) / m
+    //   v(t + dt) = v(t + dt/2) + a(t + dt) dt/2
+    // speed clipped to [minSpeed, maxSpeed], position wrapped into the torus.
+    void integrate1(size_t i, float dt, float WH) noexcept
+    {
+      const float hdt = 0.5f * dt;
+      const float lF = sa_[i].w * (sa_[i].cruiseSpeed - speed_[i]) * mass_[i];
+      const vec_t dir = dir_[i];
+      steering_[i] += lF * dir;
+      float vx = speed_[i] * dir.x + accel_[i].x * hdt;
+      float vy = speed_[i] * dir.y + accel_[i].y * hdt;
+      float px = pos_[i].x + vx * dt;
+      float py = pos_[i].y + vy * dt;
+      accel_[i].x = (force_[i].x + steering_[i].x) / mass_[i];
+      accel_[i].y = (force_[i].y + steering_[i].y) / mass_[i];
+      vx += accel_[i].x * hdt;
+      vy += accel_[i].y * hdt;
+      angc_[i] = vx * dir.y - vy * dir.x;
+      angd_[i] = vx * dir.x + vy * dir.y;
+      const float len2 = vx * vx + vy * vy;
+      const float len = std::sqrt(len2);
+      if (len2 > 0.0000001f) {
+        dir_[i] = vec_t(vx / len, vy / len);
+      }
+      speed_[i] = std::clamp(len, min_speed_[i], max_speed_[i]);
+      pos_[i].x = px - WH * std::floor(px / WH);
+      pos_[i].y = py - WH * std::floor(py / WH);
+    }
+
+#if defined(__AVX2__)
+    // x, y of the 8 pairs at p
+    static void load2(const void* p, __m256& x, __m256& y) noexcept
+    {
+      const __m256 a = _mm256_loadu_ps(static_cast<const float*>(p));       // x0 y0 x1 y1 | x2 y2 x3 y3
+      const __m256 b = _mm256_loadu_ps(static_cast<const float*>(p) + 8);   // x4 y4 x5 y5 | x6 y6 x7 y7
+      x = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));                 // x0 x1 x4 x5 | x2 x3 x6 x7
+      y = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+      x = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(x), _MM_SHUFFLE(3, 1, 2, 0)));
+      y = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(y), _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+
+    // inverse of load2
+    static void store2(void* p, __m256 x, __m256 y) noexcept
+    {
+      const __m256 lo = _mm256_unpacklo_ps(x, y);     // x0 y0 x1 y1 | x4 y4 x5 y5
+      const __m256 hi = _mm256_unpackhi_ps(x, y);     // x2 y2 x3 y3 | x6 y6 x7 y7
+      _mm256_storeu_ps(static_cast<float*>(p), _mm256_permute2f128_ps(lo, hi, 0x20));
+      _mm256_storeu_ps(static_cast<float*>(p) + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+
+    // individuals [i, i + 8), lanes outside mask keep their state
+    void integrate8(size_t i, __m256i mask, float dt, float WH) noexcept
+    {
+      const __m256 alive = _mm256_castsi256_ps(mask);
+      auto keep = [&](__m256 old, __m256 x) { return _mm256_blendv_ps(old, x, alive); };
+      const __m256 vdt = _mm256_set1_ps(dt);
+      const __m256 hdt = _mm256_set1_ps(0.5f * dt);
+      const __m256 wh = _mm256_set1_ps(WH);
+      const __m256 eps = _mm256_set1_ps(0.0000001f);
+      __m256 dx, dy, ax0, ay0, sx0, sy0, fx, fy, px0, py0, cruise, w;
+      load2(&dir_[i], dx, dy);
+      load2(&accel_[i], ax0, ay0);
+      load2(&steering_[i], sx0, sy0);
+      load2(&force_[i], fx, fy);
+      load2(&pos_[i], px0, py0);
+      load2(&sa_[i], cruise, w);
+      const __m256 speed = _mm256_loadu_ps(&speed_[i]);
+      const __m256 mass = _mm256_loadu_ps(&mass_[i]);
+
+      // cruise speed control as drag
+      const __m256 lF = _mm256_mul_ps(_mm256_mul_ps(w, _mm256_sub_ps(cruise, speed)), mass);
+      const __m256 sx = _mm256_add_ps(sx0, _mm256_mul_ps(lF, dx));
+      const __m256 sy = _mm256_add_ps(sy0, _mm256_mul_ps(lF, dy));
+
+      // modified Euler method
+      __m256 vx = _mm256_add_ps(_mm256_mul_ps(speed, dx), _mm256_mul_ps(ax0, hdt));
+      __m256 vy = _mm256_add_ps(_mm256_mul_ps(speed, dy), _mm256_mul_ps(ay0, hdt));
+      __m256 px = _mm256_add_ps(px0, _mm256_mul_ps(vx, vdt));
+      __m256 py = _mm256_add_ps(py0, _mm256_mul_ps(vy, vdt));
+      const __m256 ax = _mm256_div_ps(_mm256_add_ps(fx, sx), mass);
+      const __m256 ay = _mm256_div_ps(_mm256_add_ps(fy, sy), mass);
+      vx = _mm256_add_ps(vx, _mm256_mul_ps(ax, hdt));
+      vy = _mm256_add_ps(vy, _mm256_mul_ps(ay, hdt));
+
+      // perpDot & dot for the angular velocity
+      _mm256_storeu_ps(&angc_[i], keep(_mm256_loadu_ps(&angc_[i]), _mm256_sub_ps(_mm256_mul_ps(vx, dy), _mm256_mul_ps(vy, dx))));
+      _mm256_storeu_ps(&angd_[i], keep(_mm256_loadu_ps(&angd_[i]), _mm256_add_ps(_mm256_mul_ps(vx, dx), _mm256_mul_ps(vy, dy))));
+
+      // clip speed, save normalize
+      const __m256 len2 = _mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy));
+      const __m256 len = _mm256_sqrt_ps(len2);
+      const __m256 valid = _mm256_and_ps(_mm256_cmp_ps(len2, eps, _CMP_GT_OQ), alive);   // false for NaN
+      store2(&dir_[i], _mm256_blendv_ps(dx, _mm256_div_ps(vx, len), valid), _mm256_blendv_ps(dy, _mm256_div_ps(vy, len), valid));
+      const __m256 clipped = _mm256_min_ps(_mm256_max_ps(len, _mm256_loadu_ps(&min_speed_[i])), _mm256_loadu_ps(&max_speed_[i]));
+      _mm256_storeu_ps(&speed_[i], keep(speed, clipped));
+
+      // torus wrap
+      px = _mm256_sub_ps(px, _mm256_mul_ps(wh, _mm256_floor_ps(_mm256_div_ps(px, wh))));
+      py = _mm256_sub_ps(py, _mm256_mul_ps(wh, _mm256_floor_ps(_mm256_div_ps(py, wh))));
+      store2(&pos_[i], keep(px0, px), keep(py0, py));
+      store2(&accel_[i], keep(ax0, ax), keep(ay0, ay));
+      store2(&steering_[i], keep(sx0, sx), keep(sy0, sy));
+    }
+#endif
+
+    std::vector<pos_t> pos_;        // [m]
+    std::vector<vec_t> dir_;        // heading
+    std::vector<float> speed_;      // [m/tick]
+    std::vector<vec_t> accel_;      // [m/tick^2]
+    std::vector<vec_t> steering_;   // linear, lateral [kg * m/tick^2]
+    std::vector<vec_t> force_;      // reserved for physical forces [kg * m/tick^2]
+    std::vector<flight::state_aero<float>> sa_;          // state specific, see states
+    std::vector<float> mass_, min_speed_, max_speed_;    // aero_info
+    std::vector<float> angc_, angd_;  // perpDot, dot (vel, dir)
+    size_t size_ = 0;
+    float dt_ = 1.f;
+  };
+
+
+  // access of an individual to its entries in the kinematic store,
+  // base of the agents. Bound by the simulation, rebound if the
+  // individuals are reordered.
+  class kinematic_handle
+  {
+  public:
+    void bind(kinematic_store* ks, size_t idx) noexcept
+    {
+      ks_ = ks;
+      idx_ = static_cast<unsigned>(idx);
+    }
+
+    pos_t& pos() noexcept { return ks_->pos(idx_); }                     // [m]
+    const pos_t& pos() const noexcept { return ks_->pos(idx_); }
+    vec_t& dir() noexcept { return ks_->dir(idx_); }
+    const vec_t& dir() const noexcept { return ks_->dir(idx_); }
+    float& speed() noexcept { return ks_->speed(idx_); }                  // [m/tick]
+    float speed() const noexcept { return ks_->speed(idx_); }
+    vec_t& accel() noexcept { return ks_->accel(idx_); }                  // [m/tick ^ 2]
+    const vec_t& accel() const noexcept { return ks_->accel(idx_); }
+    vec_t& steering() noexcept { return ks_->steering(idx_); }            // linear, lateral  [kg * m/tick^2]
+    const vec_t& steering() const noexcept { return ks_->steering(idx_); }
+    vec_t& force() noexcept { return ks_->force(idx_); }                  // reserved for physical forces  [kg * m/tick^2]
+    const vec_t& force() const noexcept { return ks_->force(idx_); }
+    flight::state_aero<float>& sa() noexcept { return ks_->sa(idx_); }
+    const flight::state_aero<float>& sa() const noexcept { return ks_->sa(idx_); }
+    float ang_vel() const noexcept { return ks_->ang_vel(idx_); }         // [ 1/s ] Only for extracting data, not used in model
+
+  private:
+    kinematic_store* ks_ = nullptr;
+    unsigned idx_ = 0;
+  };
+
+}
+
+#endif
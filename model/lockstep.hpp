@@ -0,0 +1,53 @@
+#ifndef MODEL_LOCKSTEP_HPP_INCLUDED
+#define MODEL_LOCKSTEP_HPP_INCLUDED
+
+#include <vector>
+#include "simulation.hpp"
+
+
+namespace model {
+
+
+  // runs replicates of one configuration tick by tick together.
+  // Reorder, neighbor search and actions run per replicate as in
+  // Simulation::update; the integration is one parallel loop over the
+  // (replicate, integration block) pairs of all replicates.
+  // The replicates keep their own state, random streams (seed) and observers.
+  // Implemented in simulation.cpp.
+  class lockstep
+  {
+  public:
+    // the replicates shall have the same population sizes and tick
+    explicit lockstep(std::vector<Simulation*> sims);
+
+    size_t size() const noexcept { return reps_.size(); }
+    Simulation* operator[](size_t r) const noexcept { return reps_[r].sim; }
+    tick_t tick() const noexcept { return reps_.front().sim->tick(); }
+
+    // true if all replicates are terminated
+    bool terminated() const noexcept;
+
+    // observers[r] observes replicate r, may be nullptr
+    void initialize(const std::vector<class Observer*>& observers, const species_snapshots& ss);
+
+    // advances the non-terminated replicates by one tick
+    void update(const std::vector<class Observer*>& observers);
+
+  private:
+    struct replicate
+    {
+      Simulation* sim;
+      species_pop* pop;
+      Simulation::state_array* sa;
+      bool flock_tick;              // flock detection in this tick
+    };
+
+    std::vector<replicate> reps_;
+    std::vector<replicate*> active_;    // non-terminated, current tick
+
+    template <size_t S> void integrate_species();
+  };
+
+}
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef MODEL_NEIGHBOR_GRID_HPP_INCLUDED
+#define MODEL_NEIGHBOR_GRID_HPP_INCLUDED
+
+#include <cmath>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <atomic>
+#include <torus.hpp>
+#include "model.hpp"
+
+
+namespace model {
+
+
+  // periodic cell list on the torus [0,WH] x [0,WH].
+  // cells are at least 'radius' wide, thus all individuals
+  // within 'radius' are found in the 3 x 3 block of cells
+  // around the focal cell.
+  class torus_grid
+  {
+  public:
+    torus_grid() = default;
+
+    // grid is disabled if less than 3 x 3 cells fit into WH:
+    // the candidate block would cover the whole torus anyway.
+    // cells are widened by skin for the Verlet lists.
+    void reset(float WH, float radius, float skin = 0.f)
+    {
+      radius2_ = radius * radius;
+      n_ = (radius > 0.f && std::isfinite(radius)) ? static_cast<int>(WH / (radius + skin)) : 0;
+      if (n_ < 3) n_ = 0;
+      scale_ = n_ ? static_cast<float>(n_) / WH : 0.f;
+      start_.assign(static_cast<size_t>(n_) * n_ + 1, 0);
+      idx_.clear();
+    }
+
+    bool active() const noexcept { return n_ != 0; }
+    float radius2() const noexcept { return radius2_; }
+
+    // rebuilds the cell list from the alive individuals of the
+    // kinematic store ks (counting sort)
+    template <typename KS, typename UT>
+    void build(const KS& ks, const UT& update_times)
+    {
+      build_if(ks.size(), [&](size_t i) { return ks.pos(i); }, [&](size_t i) { return update_times[i] != static_cast<tick_t>(-1); });
+    }
+
+    // rebuilds the cell list from all elements of pop
+    template <typename Pop>
+    void build(const Pop& pop)
+    {
+      build_if(pop.size(), [&](size_t i) { return pop[i].pos; }, [](size_t) { return true; });
+    }
+
+    // calls fun(idx) for every individual in the 3 x 3 block around pos
+    template <typename Fun>
+    void visit(const pos_t& pos, Fun&& fun) const
+    {
+      const int cx = coor(pos.x);
+      const int cy = coor(pos.y);
+      for (int dy = -1; dy <= 1; ++dy) {
+        const int row = wrap(cy + dy) * n_;
+        for (int dx = -1; dx <= 1; ++dx) {
+          const int cell = row + wrap(cx + dx);
+          for (auto i = start_[cell]; i < start_[cell + 1]; ++i) {
+            fun(idx_[i]);
+          }
+        }
+      }
+    }
+
+  private:
+    static constexpr unsigned no_cell = static_cast<unsigned>(-1);
+
+    template <typename Pos, typename Pred>
+    void build_if(size_t n, Pos pos, Pred pred)
+    {
+      if (!active()) return;
+      cell_.resize(n);
+      std::fill(start_.begin(), start_.end(), 0u);
+      for (size_t i = 0; i < n; ++i) {
+        if (pred(i)) {
+          cell_[i] = cell_of(pos(i));
+          ++start_[cell_[i]];
+        }
+        else {
+          cell_[i] = no_cell;
+        }
+      }
+      std::partial_sum(start_.begin(), start_.end(), start_.begin());   // start_[c] = end of cell c
+      idx_.resize(start_.back());
+      for (size_t i = n; i-- > 0; ) {
+        if (cell_[i] != no_cell) {
+          idx_[--start_[cell_[i]]] = static_cast<unsigned>(i);         // start_[c] = begin of cell c
+        }
+      }
+    }
+
+    int coor(float x) const noexcept
+    {
+      return std::min(static_cast<int>(x * scale_), n_ - 1);   // x == WH is wrapped
+    }
+
+    int wrap(int c) const noexcept
+    {
+      return (c < 0) ? c + n_ : ((c >= n_) ? c - n_ : c);
+    }
+
+    unsigned cell_of(const pos_t& pos) const noexcept
+    {
+      return static_cast<unsigned>(coor(pos.y) * n_ + coor(pos.x));
+    }
+
+    int n_ = 0;                     // cells per side
+    float scale_ = 0.f;             // [1/m]
+    float radius2_ = 0.f;           // [m^2]
+    std::vector<unsigned> cell_;    // cell of individual
+    std::vector<unsigned> start_;   // first entry of cell in idx_
+    std::vector<unsigned> idx_;     // individuals ordered by cell
+  };
+
+
+  // Verlet (skin) lists: the candidates within radius + skin are cached
+  // per individual and reused until some individual moved more than
+  // skin / 2 away from its reference position. Lists are built lazily,
+  // at most once per epoch and only for individuals that ask for it.
+  class verlet_list
+  {
+  public:
+    verlet_list() = default;
+
+    void reset(float radius, float skin)
+    {
+      skin_ = (std::isfinite(radius) && skin > 0.f) ? skin : 0.f;
+      reach2_ = (radius + skin_) * (radius + skin_);
+      trigger2_ = 0.25f * skin_ * skin_;
+      invalidate();
+    }
+
+    bool active() const noexcept { return skin_ > 0.f; }
+    bool stale() const noexcept { return stale_.load(std::memory_order_relaxed); }
+    void invalidate() noexcept { stale_.store(true, std::memory_order_relaxed); }
+
+    // flags the lists stale if pos moved more than skin / 2 from its reference
+    void track(size_t idx, const pos_t& pos, float WH) noexcept
+    {
+      if (active() && !stale() && torus::distance2(WH, pos, ref_[idx]) > trigger2_) {
+        invalidate();
+      }
+    }
+
+    // starts a new epoch with the current positions of the kinematic
+    // store ks as reference. the grid shall be built from the same
+    // positions with cells of at least radius + skin.
+    template <typename KS>
+    void renew(const KS& ks)
+    {
+      const auto n = ks.size();
+      ref_.resize(n);
+      lists_.resize(n);
+      epochs_.resize(n, 0);
+      for (size_t i = 0; i < n; ++i) {
+        ref_[i] = ks.pos(i);
+      }
+      ++epoch_;
+      stale_.store(false, std::memory_order_relaxed);
+    }
+
+    // calls fun(idx) for every cached candidate of individual i.
+    // builds the list of i if outdated, safe to call concurrently for different i.
+    template <typename UT, typename Fun>
+    void visit(size_t i, const UT& update_times, const torus_grid& grid, float WH, Fun&& fun)
+    {
+      auto& list = lists_[i];
+      if (epochs_[i] != epoch_) {
+        list.clear();
+        const auto pos = ref_[i];
+        auto test = [&](unsigned j) {
+          if (j != i && torus::distance2(WH, pos, ref_[j]) <= reach2_) list.push_back(j);
+        };
+        if (grid.active()) {
+          grid.visit(pos, test);
+        }
+        else {
+          for (unsigned j = 0; j < update_times.size(); ++j) {
+            if (update_times[j] != static_cast<tick_t>(-1)) test(j);
+          }
+        }
+        epochs_[i] = epoch_;
+      }
+      for (auto j : list) {
+        fun(j);
+      }
+    }
+
+  private:
+    float skin_ = 0.f;              // [m]
+    float reach2_ = 0.f;            // (radius + skin)^2 [m^2]
+    float trigger2_ = 0.f;          // (skin / 2)^2 [m^2]
+    std::atomic<bool> stale_ = true;
+    unsigned epoch_ = 0;
+    std::vector<pos_t> ref_;                    // reference positions
+    std::vector<unsigned> epochs_;              // epoch of list
+    std::vector<std::vector<unsigned>> lists_;  // candidates
+  };
+
+}
+
+#endif
@@ -1,10 +1,14 @@
 #ifndef MODEL_OBSERVER_HPP_INCLUDED
 #define MODEL_OBSERVER_HPP_INCLUDED
 
-#include <deque>
+#include <memory>
 #include <filesystem>
 #include <string>
 #include "model/model.hpp"
+#include "model/observer_pipeline.hpp"
+#include "model/background_writer.hpp"
+#include "model/trace.hpp"
+#include "analysis/table_io.hpp"
 
 
 namespace model {
@@ -47,7 +51,11 @@ namespace model {
       AnalysisObserver(const std::filesystem::path& out_path, const json& J)
       {
           const std::string out_name = J["output_name"];
-          full_out_path_ = (out_path / (out_name + ".csv")).string();
+          if (trace::enabled()) trace_name_ = trace::intern(out_name);
+          format_ = analysis::parse_table_format(J.value("format", "csv"));
+          full_out_path_ = (out_path / (out_name + analysis::table_extension(format_))).string();
+          const json jp = J.value("precision", json(6));   // csv: significant digits or "shortest"
+          precision_ = jp.is_string() ? analysis::parse_csv_precision(jp.get<std::string>()) : jp.get<int>();
           const float freq_sec = J["sample_freq"];
           oi_.sample_tick = oi_.sample_freq = static_cast<tick_t>(freq_sec / model::Simulation::dt());
       }
@@ -65,21 +73,33 @@ namespace model {
 		  auto msg = Msg(lmsg);
 
 		  switch (msg) {
+		  case Msg::Initialized:
+			  notify_init(sim);
+			  break;
 		  case Msg::Tick: {
 			  if (sim.tick() >= oi_.sample_tick)
 			  {
-				  notify_collect(sim);
+				  if (pipeline_ && async_collect()) {
+					  // data_out_ is owned by the observer stage until Finished
+					  pipeline_->submit(sim, [this, psim = &sim](const tick_sample& smp) {
+						  trace::scope _(trace_name_, "collect");
+						  notify_collect(smp);
+						  save_overflow(*psim);
+					  });
+				  }
+				  else {
+					  trace::scope _(trace_name_, "collect");
+					  notify_collect(sim);
+				  }
 				  oi_.sample_tick = sim.tick() + oi_.sample_freq;
 			  }
-			  if (data_out_.size() > 10000) // avoid overflow 
-			  {
-				  notify_save(sim);
-				  data_out_.clear();
-			  }
+			  if (!(pipeline_ && async_collect())) save_overflow(sim);
 			  break;
 		  }
 		  case Msg::Finished:
+			  if (pipeline_) pipeline_->wait();
 			  notify_save(sim);
+			  if (writer_) writer_->wait();   // drain
 			  break;
       default:
         break;
@@ -87,14 +107,76 @@ namespace model {
 		  notify_next(lmsg, sim);
 	  }
 
+	  virtual void notify_init(const model::Simulation& sim) {};
 	  virtual void notify_collect(const model::Simulation& sim) {};
-	  virtual void notify_save(const model::Simulation& sim) {};
+
+	  // hands the collected rows to the writer thread if attached,
+	  // writes them in place otherwise
+	  virtual void notify_save(const model::Simulation& sim)
+	  {
+		  if (data_out_.empty()) return;
+		  if (writer_) {
+			  // continue with a recycled buffer
+			  std::shared_ptr<rows_t> rows;
+			  if (!spare_.try_pop(rows)) rows = std::make_shared<rows_t>(data_out_.n_cols());
+			  rows->swap(data_out_);
+			  writer_->submit([this, rows]() {
+				  trace::scope _(trace_name_, "write", rows->size());
+				  export_rows(*rows);
+				  rows->clear();
+				  spare_.push(rows);
+			  });
+		  }
+		  else {
+			  trace::scope _(trace_name_, "write", data_out_.size());
+			  export_rows(data_out_);
+		  }
+		  data_out_.clear();
+	  }
+
+	  // observers that can collect from a tick_sample run on the
+	  // observer stage if a pipeline is attached
+	  virtual bool async_collect() const noexcept { return false; }
+	  virtual void notify_collect(const tick_sample& smp) {};
+
+	  void set_pipeline(std::shared_ptr<observer_pipeline> pipeline) { pipeline_ = std::move(pipeline); }
+	  void set_writer(std::shared_ptr<background_writer> writer) { writer_ = std::move(writer); }
+
+  protected:
+	  using rows_t = analysis::row_arena;
+
+	  // opens the output table, sets the row width
+	  void open_table(const std::string& header)
+	  {
+		  out_.open(full_out_path_, header, format_, precision_);
+		  data_out_.reset(out_.n_cols(), max_rows + 1);
+	  }
+
+	  // writes rows to out_, runs on the writer thread if attached
+	  virtual void export_rows(const rows_t& rows) {};
+
+  private:
+	  void save_overflow(const model::Simulation& sim)
+	  {
+		  if (data_out_.size() > max_rows) // avoid overflow 
+		  {
+			  notify_save(sim);
+		  }
+	  }
 	   
+	  static constexpr size_t max_rows = 10000;
+
   protected:
 	   obs_info oi_;
-	   std::deque<std::vector<float>> data_out_;
-       std::ofstream outfile_stream_;
+	   rows_t data_out_;
+       analysis::table_stream out_;       // owned by the writer thread if attached
+       analysis::table_format format_;
+       int precision_;
        std::string full_out_path_;
+       const char* trace_name_ = "observer";
+       std::shared_ptr<observer_pipeline> pipeline_;
+       std::shared_ptr<background_writer> writer_;
+       tbb::concurrent_queue<std::shared_ptr<rows_t>> spare_;   // written buffers
   };
 
 }
@@ -0,0 +1,99 @@
+#ifndef MODEL_OBSERVER_PIPELINE_HPP_INCLUDED
+#define MODEL_OBSERVER_PIPELINE_HPP_INCLUDED
+
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <tbb/flow_graph.h>
+#include "sample.hpp"
+
+
+namespace model {
+
+
+  // asynchronous observer stage.
+  // the simulation thread captures a tick_sample once per sampled tick
+  // and hands it to a serial flow graph node that runs the collection
+  // concurrently with the next ticks. At most 'capacity' jobs are queued
+  // or running; if the stage falls behind, submit waits until the oldest
+  // job is done (backpressure). If no thread picks up the queued jobs (all
+  // busy, e.g. ensemble), submit runs them itself instead of blocking.
+  class observer_pipeline
+  {
+  public:
+    using job_fun = std::function<void(const tick_sample&)>;
+
+    explicit observer_pipeline(size_t capacity) :
+      capacity_(capacity),
+      stage_(graph_, tbb::flow::serial, [this](const job& j) {
+        running_.store(true, std::memory_order_relaxed);
+        j.fun(*j.smp);
+        running_.store(false, std::memory_order_relaxed);
+        {
+          std::lock_guard<std::mutex> _(slot_mutex_);
+          --inflight_;
+        }
+        slot_freed_.notify_one();
+        return tbb::flow::continue_msg{};
+      })
+    {
+    }
+
+    ~observer_pipeline()
+    {
+      wait();
+    }
+
+    // schedules fun on the sample of the current tick, simulation thread only
+    void submit(const Simulation& sim, job_fun fun)
+    {
+      if (!last_ || last_->tick() != sim.tick()) {
+        auto smp = std::make_shared<tick_sample>();
+        smp->capture(sim);
+        last_ = std::move(smp);
+      }
+      std::unique_lock<std::mutex> lock(slot_mutex_);
+      while (inflight_ >= capacity_) {
+        // stage is full, wait for one slot
+        if (!slot_freed_.wait_for(lock, std::chrono::milliseconds(1), [this]() { return inflight_ < capacity_; })
+            && !running_.load(std::memory_order_relaxed)) {
+          // queued but not picked up
+          lock.unlock();
+          graph_.wait_for_all();
+          lock.lock();
+        }
+      }
+      ++inflight_;
+      lock.unlock();
+      stage_.try_put(job{ last_, std::move(fun) });
+    }
+
+    // drains the stage
+    void wait()
+    {
+      graph_.wait_for_all();
+    }
+
+  private:
+    struct job
+    {
+      std::shared_ptr<const tick_sample> smp;
+      job_fun fun;
+    };
+
+    const size_t capacity_;
+    std::mutex slot_mutex_;
+    std::condition_variable slot_freed_;
+    size_t inflight_ = 0;                 // queued or running jobs, slot_mutex_
+    std::atomic<bool> running_ = false;   // a job is running
+    tbb::flow::graph graph_;
+    tbb::flow::function_node<job, tbb::flow::continue_msg> stage_;
+    std::shared_ptr<const tick_sample> last_;   // sample of the last submit
+  };
+
+}
+
+#endif
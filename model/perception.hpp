@@ -0,0 +1,132 @@
+#ifndef MODEL_PERCEPTION_HPP_INCLUDED
+#define MODEL_PERCEPTION_HPP_INCLUDED
+
+#include <cassert>
+#include <vector>
+#include <torus.hpp>
+#include "simulation.hpp"
+
+
+namespace model {
+
+
+  // focal individual's perception of one neighbor
+  struct percept
+  {
+    vec_t ofs;        // offset to neighbor [m]
+    float dist2;      // distance square [m^2]
+    float dist;       // distance [m]
+    float front;      // dot(dir, ofs) [m]
+    unsigned idx;     // index of neighbor
+  };
+
+
+  // perception of the own species, computed once per update of the
+  // focal individual and shared by the steering actions.
+  // the cache is thread local: an update runs on a single thread.
+  template <typename Agent>
+  class perception
+  {
+  public:
+    using Tag = typename Agent::Tag;
+
+    // perception stage, call once per update before the actions
+    static void perceive(const Agent* self, size_t idx, const Simulation& sim)
+    {
+      auto& c = cache();
+      c.self = self;
+      c.sim = &sim;
+      c.idx = idx;
+      c.extended = false;
+      c.percepts.clear();
+      append(c, sim.sorted_view<Tag>(idx));
+    }
+
+    // neighbors sorted by distance, as perceived by self.
+    // limited to the top-K row unless extended.
+    static const std::vector<percept>& view(const Agent* self) noexcept
+    {
+      assert(cache().self == self);
+      return cache().percepts;
+    }
+
+    // appends the neighbors beyond the top-K row (Simulation::scan_beyond_view)
+    // to the view, once. Returns false if there was nothing to append.
+    static bool extend(const Agent* self)
+    {
+      auto& c = cache();
+      assert(c.self == self);
+      if (c.extended) return false;
+      c.extended = true;
+      c.sim->template scan_beyond_view<Tag>(c.idx, c.beyond);
+      append(c, c.beyond);
+      return !c.beyond.empty();
+    }
+
+    // calls fun(p) for the neighbors by distance while it returns true.
+    // Runs past the top-K row if needed, see extend.
+    template <typename Fun>
+    static void visit(const Agent* self, Fun&& fun)
+    {
+      const auto& v = view(self);
+      for (size_t i = 0; (i < v.size()) || extend(self); ++i) {
+        if (!fun(v[i])) return;
+      }
+    }
+
+    // calls fun(p) for the neighbors by distance until topo of them are
+    // accepted (fun returns true), returns the number of accepted neighbors.
+    // Less than topo only if the neighborhood within the interaction radius
+    // holds less, the top-K row doesn't limit the actions.
+    template <typename Fun>
+    static size_t while_topo(const Agent* self, size_t topo, Fun&& fun)
+    {
+      auto n = topo;
+      if (n) {
+        visit(self, [&](const percept& p) {
+          if (fun(p)) --n;
+          return n != 0;
+        });
+      }
+      return topo - n;
+    }
+
+  private:
+    struct cache_t
+    {
+      const Agent* self = nullptr;
+      const Simulation* sim = nullptr;
+      size_t idx = 0;
+      bool extended = false;
+      std::vector<percept> percepts;
+      std::vector<neighbor_info> beyond;
+    };
+
+    template <typename Range>
+    static void append(cache_t& c, const Range& neighbors)
+    {
+      const auto& flock = c.sim->template pop<Tag>();
+      for (const auto& ni : neighbors) {
+        const auto ofs = torus::ofs(Simulation::WH(), c.self->pos(), flock[ni.idx].pos());
+        c.percepts.push_back({ ofs, ni.dist2, std::sqrt(ni.dist2), glm::dot(c.self->dir(), ofs), ni.idx });
+      }
+    }
+
+    static cache_t& cache() noexcept
+    {
+      thread_local cache_t c;
+      return c;
+    }
+  };
+
+
+  // same as in_fov(self, dist2, pos, act) without the geometry
+  template <typename Action>
+  inline bool in_fov(const percept& p, const Action& act)
+  {
+    return (p.dist2 != 0.0f && p.dist2 < act->maxdist2) && (p.front > p.dist * act->cfov);
+  }
+
+}
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef MODEL_PROFILER_HPP_INCLUDED
+#define MODEL_PROFILER_HPP_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <ostream>
+#include <thread>
+#include <game_watches.hpp>
+#include "model.hpp"
+
+
+namespace model {
+
+
+  // compiled in unless PIGEON_NO_PROFILE is defined,
+  // the instrumentation is dead code then.
+#ifdef PIGEON_NO_PROFILE
+  constexpr bool profiling = false;
+#else
+  constexpr bool profiling = true;
+#endif
+
+
+  enum class tick_phase : unsigned
+  {
+    reorder,        // Hilbert reordering
+    grid,           // cell list, Verlet lists, due individuals
+    neighbors,      // neighbor search
+    actions,        // state machine and actions
+    integrate,      // motion integration
+    cluster,        // flock tracking and detection
+    observers,      // Tick notification
+    tick,           // Simulation::update as a whole
+    max_phase
+  };
+
+  inline const char* phase_name(tick_phase ph) noexcept
+  {
+    static const char* names[] = { "reorder", "grid", "neighbors", "actions", "integrate", "cluster", "observers", "tick" };
+    return names[static_cast<unsigned>(ph)];
+  }
+
+
+  // log-linear histogram of durations: 4 bins per octave,
+  // the quantiles are the upper bin bounds (at most 25% high).
+  class duration_histogram
+  {
+  public:
+    static constexpr int octaves = 40;        // 1ns ... 18min
+    static constexpr int sub_bins = 4;
+
+    void add(int64_t ns) noexcept
+    {
+      ns = std::max(ns, int64_t(1));
+      ++count_;
+      sum_ += ns;
+      max_ = std::max(max_, ns);
+      int o = 0;
+      while (o + 1 < octaves && (ns >> (o + 1)) != 0) ++o;
+      const int s = (o >= 2) ? static_cast<int>((ns >> (o - 2)) & 3) : static_cast<int>((ns << (2 - o)) & 3);
+      ++bins_[o * sub_bins + s];
+    }
+
+    uint64_t count() const noexcept { return count_; }
+    int64_t sum() const noexcept { return sum_; }     // [ns]
+    int64_t max() const noexcept { return max_; }     // [ns]
+
+    // upper bound of the bin holding quantile q [ns]
+    int64_t quantile(double q) const noexcept
+    {
+      const auto rank = static_cast<uint64_t>(q * static_cast<double>(count_));
+      uint64_t n = 0;
+      for (int b = 0; b < octaves * sub_bins; ++b) {
+        n += bins_[b];
+        if (n > rank) {
+          const int o = b / sub_bins, s = b % sub_bins;
+          return std::min(max_, (int64_t(sub_bins + s + 1) << o) / sub_bins);
+        }
+      }
+      return max_;
+    }
+
+    void reset() noexcept { *this = duration_histogram{}; }
+
+  private:
+    uint64_t count_ = 0;
+    int64_t sum_ = 0;
+    int64_t max_ = 0;
+    std::array<uint32_t, octaves * sub_bins> bins_ = {};
+  };
+
+
+  // neighbor search and action watches of one update task
+  struct split_watch
+  {
+    game_watches::stop_watch<> neighbors;
+    game_watches::stop_watch<> actions;
+  };
+
+
+  // per-phase, per-species duration histograms of the ticks.
+  // disabled until enable(). The neighbor search and the actions alternate
+  // per individual inside the update loop; the wall time of the loop is
+  // attributed to both by the ratio of their summed task times.
+  // Phases that are not species specific are recorded under n_species.
+  class tick_profiler
+  {
+  public:
+    // called every 'interval' ticks and by flush(), resets the histograms afterwards
+    using sink_fun = std::function<void(const tick_profiler&, tick_t)>;
+
+    bool enabled() const noexcept { return profiling && enabled_; }
+
+    void enable(tick_t interval, sink_fun sink)
+    {
+      interval_ = std::max(interval, tick_t(1));
+      sink_ = std::move(sink);
+      enabled_ = true;
+    }
+
+    void add(tick_phase ph, size_t species, int64_t ns) noexcept
+    {
+      hist_[static_cast<unsigned>(ph)][species].add(ns);
+    }
+
+    // thread safe
+    void add_split(size_t species, const split_watch& sw) noexcept
+    {
+      using ns = std::chrono::nanoseconds;
+      split_[species][0].fetch_add(sw.neighbors.elapsed<ns>().count(), std::memory_order_relaxed);
+      split_[species][1].fetch_add(sw.actions.elapsed<ns>().count(), std::memory_order_relaxed);
+    }
+
+    // attributes the wall time of the update loop to neighbors and actions
+    void commit_split(size_t species, int64_t ns) noexcept
+    {
+      const auto nb = split_[species][0].exchange(0, std::memory_order_relaxed);
+      const auto act = split_[species][1].exchange(0, std::memory_order_relaxed);
+      const auto nb_ns = (nb + act) ? static_cast<int64_t>(static_cast<double>(ns) * nb / (nb + act)) : ns;
+      add(tick_phase::neighbors, species, nb_ns);
+      add(tick_phase::actions, species, ns - nb_ns);
+    }
+
+    const duration_histogram& histogram(tick_phase ph, size_t species) const noexcept
+    {
+      return hist_[static_cast<unsigned>(ph)][species];
+    }
+
+    // end of tick T
+    void end_tick(tick_t T)
+    {
+      if (enabled() && (T % interval_) == 0) {
+        flush(T);
+      }
+    }
+
+    // hands the pending interval to the sink
+    void flush(tick_t T)
+    {
+      if (!enabled() || histogram(tick_phase::tick, n_species).count() == 0) return;
+      sink_(*this, T);
+      for (auto& ph : hist_) {
+        for (auto& h : ph) h.reset();
+      }
+    }
+
+    static void write_csv_header(std::ostream& os)
+    {
+      os << "tick,time,phase,species,calls,total_ms,share,mean_us,p50_us,p90_us,p99_us,max_us\n";
+    }
+
+    // one row per recorded phase and species, share of the tick wall time
+    void write_csv(std::ostream& os, tick_t T, double dt, const std::array<const char*, n_species + 1>& species_names) const
+    {
+      const double tick_ns = static_cast<double>(std::max(histogram(tick_phase::tick, n_species).sum(), int64_t(1)));
+      for (unsigned p = 0; p < static_cast<unsigned>(tick_phase::max_phase); ++p) {
+        for (size_t s = 0; s <= n_species; ++s) {
+          const auto& h = hist_[p][s];
+          if (h.count() == 0) continue;
+          os << T << ',' << dt * T << ',' << phase_name(tick_phase(p)) << ',' << species_names[s] << ','
+             << h.count() << ',' << 1e-6 * h.sum() << ',' << h.sum() / tick_ns << ','
+             << 1e-3 * h.sum() / h.count() << ',' << 1e-3 * h.quantile(0.5) << ',' << 1e-3 * h.quantile(0.9) << ','
+             << 1e-3 * h.quantile(0.99) << ',' << 1e-3 * h.max() << '\n';
+        }
+      }
+    }
+
+  private:
+    bool enabled_ = false;
+    tick_t interval_ = 1;
+    sink_fun sink_;
+    std::array<std::array<duration_histogram, n_species + 1>, static_cast<unsigned>(tick_phase::max_phase)> hist_;
+    std::array<std::array<std::atomic<int64_t>, 2>, n_species> split_ = {};
+  };
+
+
+  // records the time between construction or the last lap
+  class phase_timer
+  {
+  public:
+    explicit phase_timer(tick_profiler& prof) noexcept : prof_(prof)
+    {
+      if (prof_.enabled()) sw_.start();
+    }
+
+    // records the elapsed time under phase ph and restarts
+    void lap(tick_phase ph, size_t species = n_species) noexcept
+    {
+      if (prof_.enabled()) {
+        prof_.add(ph, species, elapsed_ns());
+        sw_.restart();
+      }
+    }
+
+    // records the elapsed time as update loop, see tick_profiler::commit_split
+    void lap_split(size_t species) noexcept
+    {
+      if (prof_.enabled()) {
+        prof_.commit_split(species, elapsed_ns());
+        sw_.restart();
+      }
+    }
+
+  private:
+    int64_t elapsed_ns() const noexcept { return sw_.elapsed<std::chrono::nanoseconds>().count(); }
+
+    tick_profiler& prof_;
+    game_watches::stop_watch<> sw_;
+  };
+
+}
+
+#endif
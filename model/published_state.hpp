@@ -0,0 +1,72 @@
+#ifndef MODEL_PUBLISHED_STATE_HPP_INCLUDED
+#define MODEL_PUBLISHED_STATE_HPP_INCLUDED
+
+#include <array>
+#include <vector>
+#include <atomic>
+#include "model.hpp"
+
+
+namespace model {
+
+
+  // lock-free triple buffer, single producer, single consumer.
+  // the producer writes into back() and publishes it by swapping
+  // with the middle buffer; the consumer swaps the middle buffer
+  // into front() if it is newer. Neither side ever waits.
+  template <typename T>
+  class triple_buffer
+  {
+  public:
+    triple_buffer() = default;
+
+    // producer side
+    T& back() noexcept { return buf_[back_]; }
+
+    void publish() noexcept
+    {
+      back_ = mid_.exchange(back_ | fresh, std::memory_order_acq_rel) & index_mask;
+    }
+
+    // consumer side, latest published buffer or nullptr if none
+    const T* front() noexcept
+    {
+      if (mid_.load(std::memory_order_relaxed) & fresh) {
+        front_ = mid_.exchange(front_, std::memory_order_acq_rel) & index_mask;
+        valid_ = true;
+      }
+      return valid_ ? &buf_[front_] : nullptr;
+    }
+
+  private:
+    static constexpr unsigned fresh = 4;
+    static constexpr unsigned index_mask = 3;
+
+    std::array<T, 3> buf_;
+    unsigned back_ = 0;                 // producer
+    std::atomic<unsigned> mid_ = 1;     // index | fresh
+    unsigned front_ = 2;                // consumer
+    bool valid_ = false;                // consumer
+  };
+
+
+  // rendering state of one species
+  struct species_frame
+  {
+    long long color_map = 0;
+    std::vector<instance_proxy> instances;  // alpha: alive
+    std::vector<unsigned> ids;              // external id of individual
+    std::vector<pos_t> flock_gc;            // center of the individual's flock
+  };
+
+
+  // immutable copy of the hot state after a tick
+  struct published_frame
+  {
+    tick_t tick = 0;
+    std::array<species_frame, n_species> species;
+  };
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef MODEL_RNG_HPP_INCLUDED
+#define MODEL_RNG_HPP_INCLUDED
+
+#include <cstdint>
+#include <limits>
+
+
+namespace model {
+
+
+  // independent random streams of an individual within one tick
+  enum class rng_stream : uint32_t
+  {
+    wiggle = 1,
+    turn,
+    state,
+    target,
+    revive
+  };
+
+
+  // counter-based engine (Philox4x32-10, Salmon et al. 2011).
+  // the output is a pure function of (key, counter), thus a draw keyed by
+  // run seed, species, individual, tick and stream is reproducible
+  // independent of the thread that makes it. Cheap to create per call.
+  class philox4x32
+  {
+  public:
+    using result_type = uint32_t;
+    static constexpr result_type min() noexcept { return 0; }
+    static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+
+    philox4x32(uint64_t key, uint32_t c0, uint32_t c1, uint32_t c2) noexcept :
+      key_{ static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32) },
+      ctr_{ c0, c1, c2, 0 }
+    {
+    }
+
+    result_type operator()() noexcept
+    {
+      if (i_ == 4) {
+        block();
+        i_ = 0;
+      }
+      return out_[i_++];
+    }
+
+  private:
+    static void mulhilo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo) noexcept
+    {
+      const uint64_t p = static_cast<uint64_t>(a) * b;
+      hi = static_cast<uint32_t>(p >> 32);
+      lo = static_cast<uint32_t>(p);
+    }
+
+    void block() noexcept
+    {
+      uint32_t c[4] = { ctr_[0], ctr_[1], ctr_[2], ctr_[3] };
+      uint32_t k0 = key_[0], k1 = key_[1];
+      for (int r = 0; r < 10; ++r) {
+        uint32_t hi0, lo0, hi1, lo1;
+        mulhilo(0xD2511F53u, c[0], hi0, lo0);
+        mulhilo(0xCD9E8D57u, c[2], hi1, lo1);
+        const uint32_t n[4] = { hi1 ^ c[1] ^ k0, lo1, hi0 ^ c[3] ^ k1, lo0 };
+        c[0] = n[0]; c[1] = n[1]; c[2] = n[2]; c[3] = n[3];
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+      }
+      out_[0] = c[0]; out_[1] = c[1]; out_[2] = c[2]; out_[3] = c[3];
+      ++ctr_[3];
+    }
+
+    uint32_t key_[2];
+    uint32_t ctr_[4];
+    uint32_t out_[4] = {};
+    unsigned i_ = 4;
+  };
+
+}
+
+#endif
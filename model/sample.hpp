@@ -0,0 +1,217 @@
+#ifndef MODEL_SAMPLE_HPP_INCLUDED
+#define MODEL_SAMPLE_HPP_INCLUDED
+
+#include <array>
+#include <vector>
+#include <type_traits>
+#include "simulation.hpp"
+
+
+namespace model {
+
+
+  // observable state of one individual
+  struct sample_agent
+  {
+    pos_t pos_;
+    vec_t dir_;
+    float speed_;
+    vec_t accel_;
+    float ang_vel_;
+    float f_ali_ang, f_coh_ang, f_sep_ang;
+    int state;
+
+    // as kinematic_handle
+    const pos_t& pos() const noexcept { return pos_; }
+    const vec_t& dir() const noexcept { return dir_; }
+    float speed() const noexcept { return speed_; }
+    const vec_t& accel() const noexcept { return accel_; }
+    float ang_vel() const noexcept { return ang_vel_; }
+    const int& get_current_state() const noexcept { return state; }
+  };
+
+
+  // copy of the observable state of a tick.
+  // mimics the read-only part of Simulation the analysis observers
+  // use, thus they can collect from a sample off the simulation thread.
+  class tick_sample
+  {
+  public:
+    tick_sample() = default;
+
+    void capture(const Simulation& sim);
+
+    tick_t tick() const noexcept { return tick_; }
+    static float WH() noexcept { return Simulation::WH(); }
+    static float dt() noexcept { return Simulation::dt(); }
+
+    template <typename Tag>
+    const std::vector<sample_agent>& pop() const noexcept
+    {
+      return species_[Tag::value].agents;
+    }
+
+    template <typename Tag, typename OtherTag = Tag>
+    neighbor_info_view sorted_view(size_t idx) const noexcept
+    {
+      return species_[Tag::value].neighbors[OtherTag::value].view(idx);
+    }
+
+    template <typename Tag, typename OtherTag = Tag>
+    neighbor_info_view observed_view(size_t idx) const noexcept
+    {
+      const auto& s = species_[Tag::value];
+      return s.widened[OtherTag::value] ? s.observed[OtherTag::value].view(idx) : s.neighbors[OtherTag::value].view(idx);
+    }
+
+    template <typename Tag>
+    size_t id(size_t idx) const noexcept
+    {
+      return species_[Tag::value].ids[idx];
+    }
+
+    template <typename Tag>
+    const std::vector<flock_descr>& flocks() const noexcept
+    {
+      return species_[Tag::value].flocks;
+    }
+
+    template <typename Tag>
+    flock_descr flock_info(size_t flock_id) const
+    {
+      const auto& fl = species_[Tag::value].flocks;
+      return (flock_id < fl.size()) ? fl[flock_id] : flock_descr{};
+    }
+
+    template <typename Tag>
+    int flock_of(size_t idx) const
+    {
+      return species_[Tag::value].flock_of[idx];
+    }
+
+    template <typename Tag>
+    const std::vector<model::flock_sums>& flock_sums() const
+    {
+      return species_[Tag::value].sums;
+    }
+
+    template <typename Tag, typename Fun>
+    size_t visit_all(Fun&& fun) const
+    {
+      const auto& s = species_[Tag::value];
+      for (size_t i = 0; i < s.agents.size(); ++i) {
+        fun(s.agents[i], i, static_cast<bool>(s.alive[i]));
+      }
+      return s.agents.size();
+    }
+
+  private:
+    struct neighbors_t
+    {
+      std::vector<unsigned> start;        // first entry of individual in info
+      std::vector<neighbor_info> info;
+
+      neighbor_info_view view(size_t idx) const noexcept
+      {
+        return { info.data() + start[idx], start[idx + 1] - start[idx] };
+      }
+
+      template <typename ViewFun>
+      void capture(size_t n, ViewFun&& view_fun)
+      {
+        start.resize(n + 1);
+        info.clear();
+        start[0] = 0;
+        for (size_t i = 0; i < n; ++i) {
+          const auto sv = view_fun(i);
+          info.insert(info.end(), sv.cbegin(), sv.cend());
+          start[i + 1] = static_cast<unsigned>(info.size());
+        }
+      }
+    };
+
+    struct species_t
+    {
+      std::vector<sample_agent> agents;
+      std::vector<char> alive;
+      std::vector<unsigned> ids;
+      std::vector<int> flock_of;
+      std::vector<flock_descr> flocks;
+      std::vector<model::flock_sums> sums;
+      std::array<neighbors_t, n_species> neighbors;   // sorted views
+      std::array<neighbors_t, n_species> observed;    // observed views if widened
+      std::array<bool, n_species> widened = {};
+    };
+
+    template <size_t S, size_t S2 = 0> struct capture_species;
+
+    tick_t tick_ = 0;
+    std::array<species_t, n_species> species_;
+  };
+
+
+  namespace detail {
+
+    template <typename Agent, typename = void>
+    struct has_force_angles : std::false_type {};
+
+    template <typename Agent>
+    struct has_force_angles<Agent, std::void_t<decltype(std::declval<Agent>().f_ali_ang)>> : std::true_type {};
+
+  }
+
+
+  template <size_t S, size_t S2>
+  struct tick_sample::capture_species
+  {
+    static void apply(tick_sample& smp, const Simulation& sim)
+    {
+      using Tag = std::integral_constant<size_t, S>;
+      using OtherTag = std::integral_constant<size_t, S2>;
+      auto& s = smp.species_[S];
+      const auto n = sim.pop<Tag>().size();
+      s.neighbors[S2].capture(n, [&](size_t i) { return sim.sorted_view<Tag, OtherTag>(i); });
+      s.widened[S2] = sim.widened_view<Tag, OtherTag>();
+      if (s.widened[S2]) {
+        s.observed[S2].capture(n, [&](size_t i) { return sim.observed_view<Tag, OtherTag>(i); });
+      }
+      if constexpr (S2 == 0) {
+        s.agents.resize(n);
+        s.alive.resize(n);
+        s.ids.resize(n);
+        s.flock_of.resize(n);
+        sim.visit_all<Tag>([&](const auto& p, size_t idx, bool alive) {
+          using Agent = std::decay_t<decltype(p)>;
+          auto& a = s.agents[idx];
+          a = { p.pos(), p.dir(), p.speed(), p.accel(), p.ang_vel(), 0.f, 0.f, 0.f, p.get_current_state() };
+          if constexpr (detail::has_force_angles<Agent>::value) {
+            a.f_ali_ang = p.f_ali_ang;
+            a.f_coh_ang = p.f_coh_ang;
+            a.f_sep_ang = p.f_sep_ang;
+          }
+          s.alive[idx] = alive;
+          s.ids[idx] = static_cast<unsigned>(sim.id<Tag>(idx));
+          s.flock_of[idx] = sim.flock_of<Tag>(idx);
+        });
+        s.flocks = sim.flocks<Tag>();
+        s.sums = sim.flock_sums<Tag>();
+      }
+      if constexpr (S2 + 1 < n_species) {
+        capture_species<S, S2 + 1>::apply(smp, sim);
+      }
+      else if constexpr (S + 1 < n_species) {
+        capture_species<S + 1, 0>::apply(smp, sim);
+      }
+    }
+  };
+
+
+  inline void tick_sample::capture(const Simulation& sim)
+  {
+    tick_ = sim.tick();
+    capture_species<0>::apply(*this, sim);
+  }
+
+}
+
+#endif
@@ -1,10 +1,13 @@
 #include <atomic>
 #include <hrtree/sorting/radix_sort.hpp>
+#include <hrtree/sorting/parallel_radix_sort.hpp>
+#include <hrtree/isfc/hilbert.hpp>
 #include <rndutils.hpp>
 #include "tbb/tbb.h"
 #include "model.hpp"
 #include "agents/agents.hpp"
 #include "simulation.hpp"
+#include "lockstep.hpp"
 #include "observer.hpp"
 
 
@@ -28,8 +31,9 @@ namespace model {
       if (!ss.empty()) {
         auto& pops = std::get<S>(pop);
         if (pops.size() != ss.size()) throw std::runtime_error("snapshot mismatch");
-        for (size_t i = 0; i < pops.size(); ++i) {
-          pops[i].snapshot(sim, i, ss[i]);
+        for (size_t id = 0; id < pops.size(); ++id) {
+          const auto i = sim->idx_of<std::integral_constant<size_t, S>>(id);
+          pops[i].snapshot(sim, i, ss[id]);
         }
       }
       set_snapshot<S + 1>(sim, pop, s);
@@ -45,8 +49,9 @@ namespace model {
     {
       auto& ss = std::get<S>(s);
       auto& pops = std::get<S>(pop);
+      ss.resize(pops.size());
       for (size_t i = 0; i < pops.size(); ++i) {
-        ss.push_back(pops[i].snapshot(sim, i));
+        ss[sim->id<std::integral_constant<size_t, S>>(i)] = pops[i].snapshot(sim, i);
       }
       get_snapshot<S + 1>(sim, pop, s);
     }
@@ -56,6 +61,45 @@ namespace model {
     {}
 
 
+    // largest 'maxdist' [m] of all actions of a species.
+    // infinite if no action defines 'maxdist'.
+    float max_interaction_radius(const json& js)
+    {
+      float maxdist = 0.f;
+      for (const auto& state : js["states"]) {
+        for (const auto& action : state["actions"]) {
+          if (action.contains("maxdist")) {
+            maxdist = std::max(maxdist, float(action["maxdist"]));
+          }
+        }
+      }
+      return (maxdist > 0.f) ? maxdist : std::numeric_limits<float>::infinity();
+    }
+
+
+    // largest 'topo' of all actions of a species, at least one.
+    size_t max_topo(const json& js)
+    {
+      size_t topo = 1;
+      for (const auto& state : js["states"]) {
+        for (const auto& action : state["actions"]) {
+          if (action.contains("topo")) {
+            topo = std::max(topo, size_t(action["topo"]));
+          }
+        }
+      }
+      return topo;
+    }
+
+
+    // optional "neighbors" block in "Simulation"
+    json neighbors_config(const json& J)
+    {
+      const auto& js = J["Simulation"];
+      return js.contains("neighbors") ? js["neighbors"] : json::object();
+    }
+
+
     template <size_t I>
     struct init_simulation_impl
     {
@@ -68,13 +112,29 @@ namespace model {
         for (size_t i = 0; i < N; ++i) {
           popi.emplace_back(i, ji);
         }
+        auto& ks = sa[I].kinematics;
+        ks.resize(N);
+        for (size_t i = 0; i < N; ++i) {
+          popi[i].bind(&ks, i);
+          ks.reset(i, popi[i].ai);
+        }
         sa[I].alive = N;
         sa[I].update_times.resize(N);
+        sa[I].ids.resize(N);
+        std::iota(sa[I].ids.begin(), sa[I].ids.end(), 0u);
+        sa[I].slots = sa[I].ids;
+        const float radius = max_interaction_radius(ji);
+        const float skin = neighbors_config(J).value("skin", 0.f);
+        sa[I].verlet.reset(radius, skin);
+        sa[I].grid.reset(Simulation::WH(), radius, sa[I].verlet.active() ? skin : 0.f);
         auto ut_dist = std::uniform_int_distribution<tick_t>(0, static_cast<tick_t>(1.0 / Simulation::dt()));
         for (auto& ut : sa[I].update_times) {
           ut = ut_dist(reng);
         }
-        apply_cross<0>(J, sa);
+        sa[I].queue.reset(N, static_cast<tick_t>(1.0 / Simulation::dt()));
+        sa[I].queue.assign(sa[I].update_times, 0);
+        const size_t topk = max_topo(ji) + size_t(neighbors_config(J).value("slack", 0));
+        apply_cross<0>(J, sa, topk);
         init_simulation_impl<I + 1>::apply(J, pop, sa, sim);
         for (size_t i = 0; i < N; ++i) {
           popi[i].initialize(i, sim, ji);
@@ -85,18 +145,21 @@ namespace model {
         set_snapshot<I>(&sim, pop, ss );
       }
 
+      // sparse neighbor storage: topk nearest alive neighbors per row
       template <size_t K>
-      static void apply_cross(const json& J, state_array& sa)
+      static void apply_cross(const json& J, state_array& sa, size_t topk)
       {
         using agent_type = typename std::tuple_element_t<K, species_pop>::value_type;
         const auto& jk = J[agent_type::name()];
         const size_t N = jk["N"];
-        sa[I].NI[K].resize(sa[I].alive * N);
-        apply_cross<K + 1>(J, sa);
+        sa[I].topk[K] = std::min(topk, N);
+        sa[I].NI[K].resize(sa[I].alive * sa[I].topk[K]);
+        sa[I].NN[K].assign(sa[I].alive, 0);
+        apply_cross<K + 1>(J, sa, topk);
       }
 
       template <>
-      static void apply_cross<n_species>(const json&, state_array&) {}
+      static void apply_cross<n_species>(const json&, state_array&, size_t) {}
     };
 
 
@@ -113,6 +176,9 @@ namespace model {
     }
   
 
+    thread_local std::vector<neighbor_info> neighbor_buffer;   // candidates of sparse rows
+
+
     struct radix_sort_converter
     {
       static const int key_bytes = sizeof(float);
@@ -120,6 +186,80 @@ namespace model {
     };
 
 
+    // sorts the k nearest neighbors in [first, last) to the front and returns
+    // the end of the sorted prefix. Partial selection if k < last - first,
+    // full sort otherwise (e.g. full views).
+    template <typename IT>
+    IT rank_neighbors(IT first, IT last, size_t k)
+    {
+      if (static_cast<size_t>(std::distance(first, last)) > k) {
+        const auto kth = first + k;
+        std::nth_element(first, kth, last, [](const auto& a, const auto& b) { return a.dist2 < b.dist2; });
+        last = kth;
+      }
+#ifdef _DEBUG
+      // visual studio debug build crawls trough radix sort
+      std::sort(first, last, [](const auto& a, const auto& b) { return a.dist2 < b.dist2; });
+#else
+      hrtree::inplace_radix_sort(first, last, radix_sort_converter{});
+#endif
+      return last;
+    }
+
+
+    // writes the candidate neighbors of individual idx of species I
+    // among species J to out, returns the end of the candidates.
+    // The own species is searched in the Verlet or cell list (alive within
+    // the interaction radius) unless all_alive is set.
+    template <size_t I, size_t J, typename IT>
+    IT collect_candidates(const Simulation* sim, size_t idx, state_array& sa, IT out, bool all_alive)
+    {
+      using agent_type = typename std::tuple_element_t<I, species_pop>::value_type;
+      const auto& ksj = sa[J].kinematics;
+      const auto& utj = sa[J].update_times;
+      const auto& grid = sa[J].grid;
+      const auto pos = sa[I].kinematics.pos(idx);
+      if (I == J && sa[J].verlet.active() && !all_alive) {
+        // candidates from the Verlet list, distances refreshed
+        const auto r2 = grid.radius2();
+        sa[J].verlet.visit(idx, utj, grid, Simulation::WH(), [&](unsigned j) {
+          if (utj[j] != static_cast<tick_t>(-1)) {
+            const auto dist2 = agent_type::distance2(pos, ksj.pos(j));
+            if (dist2 <= r2) *out++ = { dist2, j, 0.f };
+          }
+        });
+      }
+      else if (I == J && grid.active() && !all_alive) {
+        // candidates from the cell list, alive only
+        const auto r2 = grid.radius2();
+        grid.visit(pos, [&](unsigned j) {
+          const auto dist2 = agent_type::distance2(pos, ksj.pos(j));
+          if (j != idx && dist2 <= r2) {
+            *out++ = { dist2, j, 0.f };
+          }
+        });
+      }
+      else {
+        for (unsigned j = 0; j < ksj.size(); ++j) {
+          if ((I != J || j != idx) && utj[j] != static_cast<tick_t>(-1)) {
+            *out++ = { agent_type::distance2(pos, ksj.pos(j)), j, 0.f };
+          }
+        }
+      }
+      return out;
+    }
+
+
+    template <size_t I, size_t J, typename IT>
+    void set_bearing(const state_array& sa, size_t idx, IT first, IT last)
+    {
+      using agent_type = typename std::tuple_element_t<I, species_pop>::value_type;
+      const auto& ksi = sa[I].kinematics;
+      const auto& ksj = sa[J].kinematics;
+      std::for_each(first, last, [&](auto& ni) { ni.bangl = agent_type::bearing_angl(ksi.dir(idx), ksi.pos(idx), ksj.pos(ni.idx)); });
+    }
+
+
     template <size_t I>
     class update_neighbor_info 
     {
@@ -133,29 +273,33 @@ namespace model {
       template <size_t J>
       static void apply_(Simulation* sim, size_t idx, state_array& sa)
       {
-        using agent_type = typename std::tuple_element_t<I, species_pop>::value_type;
-        auto& nis = sa[I].NI[J];
-        const auto& popi = sim->pop<std::integral_constant<size_t, I>>();
-        const auto& popj = sim->pop<std::integral_constant<size_t, J>>();
-        const auto& uti = sa[I].update_times;
-        const auto& utj = sa[J].update_times;
-        auto pos = popi[idx].pos;
-        auto dir = popi[idx].dir;
-
-        auto first = nis.begin() + (popj.size() * idx);
-        auto it = first;
-        for (unsigned j = 0; j < popj.size(); ++j, ++it) {
-          *it = { agent_type::distance2(pos, popj[j].pos), j, agent_type::bearing_angl(dir, pos, popj[j].pos) };
+        auto& s = sa[I];
+        const auto topk = s.topk[J];
+
+        // candidates are ranked in the scratch buffer, rows receive the head
+        auto& buf = neighbor_buffer;
+        buf.resize(sim->pop<std::integral_constant<size_t, J>>().size());
+        const auto first = buf.begin();
+        auto it = collect_candidates<I, J>(sim, idx, sa, first, false);
+        const auto last = rank_neighbors(first, it, topk);
+        set_bearing<I, J>(sa, idx, first, last);
+        std::copy(first, last, s.NI[J].begin() + (topk * idx));
+        s.NN[J][idx] = static_cast<unsigned>(std::distance(first, last));
+        if (const auto k = s.obs_k[J]; k != 0) {
+          // observer row: the action row followed by the next nearest, or all alive
+          auto olast = last;
+          if (s.obs_full[J]) {
+            it = collect_candidates<I, J>(sim, idx, sa, first, true);
+            olast = rank_neighbors(first, it, k);
+            set_bearing<I, J>(sa, idx, first, olast);
+          }
+          else {
+            olast = rank_neighbors(last, it, k - std::distance(first, last));
+            set_bearing<I, J>(sa, idx, last, olast);
+          }
+          std::copy(first, olast, s.ONI[J].begin() + (k * idx));
+          s.ONN[J][idx] = static_cast<unsigned>(std::distance(first, olast));
         }
-        auto first_alive = std::partition(first, it, [&](const auto& ni) { return utj[ni.idx] == static_cast<tick_t>(-1); });
-        std::for_each(first, first_alive, [=](auto& ni) { ni.dist2 = std::numeric_limits<float>::max(); });
-#ifdef _DEBUG
-        // visual studio debug build crawls trough radix sort
-        std::sort(first_alive, it, [](const auto& a, const auto& b) { return a.dist2 < b.dist2; });
-#else
-        hrtree::inplace_radix_sort(first, it, radix_sort_converter{});
-#endif
-        sa[J].alive = std::distance(first_alive, it);
         apply_<J + 1>(sim, idx, sa);
       }
 
@@ -165,20 +309,108 @@ namespace model {
     };
 
 
+    // see Simulation::scan_beyond_view
     template <size_t S>
-    void update_species(Simulation* sim, species_pop& pop, state_array& sa)
+    void scan_beyond_row(const Simulation* sim, size_t S1, size_t idx, state_array& sa, std::vector<neighbor_info>& out)
     {
-      auto& pops = std::get<S>(pop);
+      if (S1 != S) {
+        scan_beyond_row<S + 1>(sim, S1, idx, sa, out);
+        return;
+      }
+      out.clear();
+      const auto topk = sa[S].topk[S];
+      if (sa[S].NN[S][idx] < topk) return;     // the row holds all candidates
+      out.resize(sim->pop<std::integral_constant<size_t, S>>().size());
+      const auto last = collect_candidates<S, S>(sim, idx, sa, out.begin(), false);
+      out.erase(last, out.end());
+      if (out.size() <= topk) {
+        out.clear();
+        return;
+      }
+      // same input and partition as the row, the tail is its complement
+      std::nth_element(out.begin(), out.begin() + topk, out.end(), [](const auto& a, const auto& b) { return a.dist2 < b.dist2; });
+      out.erase(out.begin(), out.begin() + topk);
+      rank_neighbors(out.begin(), out.end(), out.size());
+      set_bearing<S, S>(sa, idx, out.begin(), out.end());
+    }
+
+    template <>
+    void scan_beyond_row<model::n_species>(const Simulation*, size_t, size_t, state_array&, std::vector<neighbor_info>&)
+    {}
+
+
+    // individuals per task, an update is a neighbor search plus actions
+    constexpr size_t update_grain = 8;
+
+    // cell list of species S, returns the individuals due in the current tick
+    template <size_t S>
+    const std::vector<unsigned>& due_species(Simulation* sim, species_pop& pop, state_array& sa)
+    {
+      const auto& ks = std::get<S>(sa).kinematics;
       auto& uts = std::get<S>(sa).update_times;
-      const auto T = sim->tick();
-      tbb::parallel_for(tbb::blocked_range<size_t>(0, pops.size()), [&, sim, T](const auto& r) {
-        for (auto i = r.begin(); i < r.end(); ++i) {
-          if (uts[i] <= T) {
-            update_neighbor_info<S>::apply(sim, i, sa);
-            uts[i] = pops[i].update(i, T, *sim);
+      auto& vl = std::get<S>(sa).verlet;
+      if (!vl.active()) {
+        std::get<S>(sa).grid.build(ks, uts);
+      }
+      else if (vl.stale()) {
+        std::get<S>(sa).grid.build(ks, uts);
+        vl.renew(ks);
+      }
+      const auto& due = std::get<S>(sa).queue.drain(uts, sim->tick());
+      std::get<S>(sa).updates += due.size();
+      return due;
+    }
+
+    // neighbor search and actions of individual i
+    template <size_t S>
+    void update_individual(Simulation* sim, species_pop& pop, state_array& sa, size_t i)
+    {
+      update_neighbor_info<S>::apply(sim, i, sa);
+      std::get<S>(sa).update_times[i] = std::get<S>(pop)[i].update(i, sim->tick(), *sim);
+    }
+
+    // profiled version
+    template <size_t S>
+    void update_individual(Simulation* sim, species_pop& pop, state_array& sa, size_t i, split_watch& sw)
+    {
+      sw.neighbors.start();
+      update_neighbor_info<S>::apply(sim, i, sa);
+      sw.neighbors.stop();
+      sw.actions.start();
+      std::get<S>(sa).update_times[i] = std::get<S>(pop)[i].update(i, sim->tick(), *sim);
+      sw.actions.stop();
+    }
+
+    template <size_t S>
+    void update_species(Simulation* sim, species_pop& pop, state_array& sa)
+    {
+      using agent_type = typename std::tuple_element_t<S, species_pop>::value_type;
+      auto& prof = sim->profiler();
+      phase_timer timer(prof);
+      const auto& due = [&]() -> const auto& {
+        trace::scope _("grid", agent_type::name());
+        return due_species<S>(sim, pop, sa);
+      }();
+      timer.lap(tick_phase::grid, S);
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, due.size(), update_grain), [&, sim](const auto& r) {
+        trace::scope _("update", agent_type::name(), r.size());
+        if (prof.enabled()) {
+          split_watch sw;
+          for (auto d = r.begin(); d < r.end(); ++d) {
+            update_individual<S>(sim, pop, sa, due[d], sw);
           }
+          prof.add_split(S, sw);
+          return;
+        }
+        for (auto d = r.begin(); d < r.end(); ++d) {
+          update_individual<S>(sim, pop, sa, due[d]);
         }
       });
+      timer.lap_split(S);
+      auto& queue = std::get<S>(sa).queue;
+      for (auto i : due) {
+        queue.push(i, std::get<S>(sa).update_times[i], sim->tick() + 1);
+      }
       update_species<S + 1>(sim, pop, sa);
     }
 
@@ -187,21 +419,46 @@ namespace model {
     {}
 
 
+    // individuals per task, multiple of kinematic_store::width
+    constexpr size_t integrate_grain = 64;
+
+    // integrates the alive individuals of the blocks r (kinematic_store::width
+    // individuals each), calls fun(idx) for every integrated individual
+    template <size_t S, typename Fun>
+    void integrate_range(state_array& sa, const tbb::blocked_range<size_t>& r, Fun&& fun)
+    {
+      const auto& uts = std::get<S>(sa).update_times;
+      auto& ks = std::get<S>(sa).kinematics;
+      const auto first = r.begin() * kinematic_store::width;
+      const auto last = std::min(r.end() * kinematic_store::width, ks.size());
+      ks.integrate(first, last, uts, Simulation::dt(), Simulation::WH());
+      for (auto i = first; i < last; ++i) {
+        if (uts[i] != static_cast<tick_t>(-1)) {
+          fun(i);
+        }
+      }
+    }
+
+
     template <size_t S>
     void integrate_species(Simulation* sim, species_pop& pop, state_array& sa)
     {
-      auto& pops = std::get<S>(pop);
-      auto& uts = std::get<S>(sa).update_times;
-      const auto T = sim->tick();
-      tbb::parallel_for(tbb::blocked_range<size_t>(0, pops.size()), [&, sim, T](const auto& r) {
-        for (auto i = r.begin(); i < r.end(); ++i) {
-          if (uts[i] != static_cast<tick_t>(-1)) {
-            pops[i].integrate(T, *sim);
-          }
-        }
+      using agent_type = typename std::tuple_element_t<S, species_pop>::value_type;
+      const auto& ks = std::get<S>(sa).kinematics;
+      auto& vl = std::get<S>(sa).verlet;
+      phase_timer timer(sim->profiler());
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, ks.blocks(), integrate_grain / kinematic_store::width), [&](const auto& r) {
+        trace::scope _("integrate", agent_type::name(), r.size());
+        integrate_range<S>(sa, r, [&](size_t i) {
+          vl.track(i, ks.pos(i), Simulation::WH());
+        });
       });
+      timer.lap(tick_phase::integrate, S);
       integrate_species<S + 1>(sim, pop, sa);
+      phase_timer track_timer(sim->profiler());
+      trace::scope _("cluster", agent_type::name());
       std::get<S>(sa).flock_tracker.track();
+      track_timer.lap(tick_phase::cluster, S);
     }
 
 
@@ -209,30 +466,173 @@ namespace model {
     void integrate_species<model::n_species>(Simulation*, species_pop&, state_array&)
     {}
 
+
+    using hilbert_key = hrtree::hilbert<2, 16>::type;
+
+    struct reorder_entry
+    {
+      unsigned key;   // Hilbert key of position
+      unsigned idx;
+    };
+
+    struct reorder_converter
+    {
+      static const int key_bytes = sizeof(unsigned);
+      const std::uint8_t* operator()(const reorder_entry& e) const { return reinterpret_cast<const std::uint8_t*>(&e.key); }
+    };
+
+    // v[i] = v[perm[i]]
+    template <typename T>
+    void permute(std::vector<T>& v, const std::vector<unsigned>& perm)
+    {
+      std::vector<T> tmp;
+      tmp.reserve(v.size());
+      for (auto p : perm) {
+        tmp.push_back(std::move(v[p]));
+      }
+      v.swap(tmp);
+    }
+
+    // sorts the individuals along the Hilbert curve of their position,
+    // dead individuals go to the back. Spatial neighbors become neighbors
+    // in memory, external ids (Simulation::id) are preserved.
     template <size_t S>
-    void integrate_species_flock(Simulation* sim, species_pop& pop, state_array& sa, float fdd)
+    void reorder_species(Simulation* sim, species_pop& pop, state_array& sa)
     {
       auto& pops = std::get<S>(pop);
-      auto& uts = std::get<S>(sa).update_times;
-      auto& fts = std::get<S>(sa).flock_tracker;
-      fts.prepare(pops.size());
-      const auto T = sim->tick();
-      tbb::parallel_for(tbb::blocked_range<size_t>(0, pops.size()), [&, sim, T](const auto& r) {
-        for (auto i = r.begin(); i < r.end(); ++i) {
-          if (uts[i] != static_cast<tick_t>(-1)) {
-            pops[i].integrate(T, *sim);
-            fts.feed(pops[i], i);
+      auto& s = std::get<S>(sa);
+      auto& ks = s.kinematics;
+      const auto n = pops.size();
+      std::vector<reorder_entry> entries(n), buf(n);
+      const float scale = static_cast<float>(hilbert_key::max_arg) / Simulation::WH();
+      for (size_t i = 0; i < n; ++i) {
+        entries[i] = { static_cast<unsigned>(-1), static_cast<unsigned>(i) };
+        if (s.update_times[i] != static_cast<tick_t>(-1)) {
+          const hilbert_key::arg_type args[2] = {
+            std::min(static_cast<hilbert_key::arg_type>(ks.pos(i).x * scale), hilbert_key::max_arg),
+            std::min(static_cast<hilbert_key::arg_type>(ks.pos(i).y * scale), hilbert_key::max_arg)
+          };
+          entries[i].key = static_cast<unsigned>(hilbert_key(args).asWord());
+        }
+      }
+      if (hrtree::sorting::parallel_radix_sort(entries.begin(), entries.end(), buf.begin(), reorder_converter{})) {
+        entries.swap(buf);
+      }
+      std::vector<unsigned> perm(n), inv(n);
+      bool identity = true;
+      for (size_t i = 0; i < n; ++i) {
+        perm[i] = entries[i].idx;
+        inv[perm[i]] = static_cast<unsigned>(i);
+        identity = identity && (perm[i] == i);
+      }
+      if (!identity) {
+        permute(pops, perm);
+        ks.permute(perm);
+        for (size_t i = 0; i < n; ++i) {
+          pops[i].bind(&ks, i);
+        }
+        permute(s.update_times, perm);
+        permute(s.ids, perm);
+        for (size_t i = 0; i < n; ++i) {
+          s.slots[s.ids[i]] = static_cast<unsigned>(i);
+        }
+        // rows of S and references to S in the rows of all species
+        auto permute_rows = [&](std::vector<neighbor_info>& rows, std::vector<unsigned>& nn, size_t k) {
+          std::vector<neighbor_info> tmp(rows.size());
+          for (size_t i = 0; i < n; ++i) {
+            std::copy_n(rows.cbegin() + perm[i] * k, k, tmp.begin() + i * k);
+          }
+          rows.swap(tmp);
+          permute(nn, perm);
+        };
+        auto remap_rows = [&](std::vector<neighbor_info>& rows, const std::vector<unsigned>& nn, size_t k) {
+          for (size_t i = 0; i < nn.size(); ++i) {
+            auto first = rows.begin() + i * k;
+            std::for_each(first, first + nn[i], [&](auto& ni) { ni.idx = inv[ni.idx]; });
           }
+        };
+        for (size_t K = 0; K < n_species; ++K) {
+          permute_rows(s.NI[K], s.NN[K], s.topk[K]);
+          if (s.obs_k[K]) permute_rows(s.ONI[K], s.ONN[K], s.obs_k[K]);
         }
+        for (size_t K = 0; K < n_species; ++K) {
+          auto& sk = sa[K];
+          remap_rows(sk.NI[S], sk.NN[S], sk.topk[S]);
+          if (sk.obs_k[S]) remap_rows(sk.ONI[S], sk.ONN[S], sk.obs_k[S]);
+        }
+        s.flock_tracker.permute(perm);
+        s.verlet.invalidate();
+        s.queue.assign(s.update_times, sim->tick());
+      }
+      reorder_species<S + 1>(sim, pop, sa);
+    }
+
+    template <>
+    void reorder_species<model::n_species>(Simulation*, species_pop&, state_array&)
+    {}
+
+    template <size_t S>
+    void integrate_species_flock(Simulation* sim, species_pop& pop, state_array& sa, float fdd)
+    {
+      const auto& ks = std::get<S>(sa).kinematics;
+      auto& fts = std::get<S>(sa).flock_tracker;
+      auto& vl = std::get<S>(sa).verlet;
+      using agent_type = typename std::tuple_element_t<S, species_pop>::value_type;
+      phase_timer timer(sim->profiler());
+      fts.prepare(ks.size());
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, ks.blocks(), integrate_grain / kinematic_store::width), [&](const auto& r) {
+        trace::scope _("integrate", agent_type::name(), r.size());
+        integrate_range<S>(sa, r, [&](size_t i) {
+          vl.track(i, ks.pos(i), Simulation::WH());
+          fts.feed(ks, i);
+        });
       });
+      timer.lap(tick_phase::integrate, S);
       integrate_species_flock<S + 1>(sim, pop, sa, fdd);
-      fts.cluster(fdd);
+      phase_timer cluster_timer(sim->profiler());
+      trace::scope _("cluster", agent_type::name());
+      fts.cluster(fdd, sim->tick());
+      cluster_timer.lap(tick_phase::cluster, S);
     }
 
     template <>
     void integrate_species_flock<model::n_species>(Simulation*, species_pop&, state_array&, float)
     {}
 
+
+    template <size_t S>
+    void publish_species(const Simulation* sim, published_frame& frame, long long color_map)
+    {
+      using Tag = std::integral_constant<size_t, S>;
+      const auto& pops = sim->pop<Tag>();
+      auto& sf = frame.species[S];
+      sf.color_map = color_map;
+      sf.instances.resize(pops.size());
+      sf.ids.resize(pops.size());
+      sf.flock_gc.resize(pops.size());
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, pops.size(), integrate_grain), [&](const auto& r) {
+        for (auto i = r.begin(); i < r.end(); ++i) {
+          auto& inst = sf.instances[i];
+          inst = pops[i].instance_proxy(color_map, i, sim);
+          inst.alpha = sim->is_alive<Tag>(i) ? 1.f : 0.f;
+          sf.ids[i] = static_cast<unsigned>(sim->id<Tag>(i));
+          const auto fi = sim->flock_of<Tag>(i);
+          sf.flock_gc[i] = (fi >= 0 && static_cast<size_t>(fi) < sim->flocks<Tag>().size()) ? sim->flocks<Tag>()[fi].gc() : pops[i].pos();
+        }
+      });
+    }
+
+    template <size_t S>
+    void publish_all(const Simulation* sim, published_frame& frame, const std::array<std::atomic<long long>, n_species>& cm)
+    {
+      publish_species<S>(sim, frame, cm[S].load(std::memory_order_relaxed));
+      publish_all<S + 1>(sim, frame, cm);
+    }
+
+    template <>
+    void publish_all<model::n_species>(const Simulation*, published_frame&, const std::array<std::atomic<long long>, n_species>&)
+    {}
+
   }
   
 
@@ -247,16 +647,31 @@ namespace model {
   Simulation::Simulation(const json& J) :
     tick_(0)
   {
-    WH_ = J["Simulation"]["WH"];
-    dt_ = J["Simulation"]["dt"];
+    // shared by all simulations of the process, see set_world
+    if (WH_ != float(J["Simulation"]["WH"]) || dt_ != float(J["Simulation"]["dt"])) {
+      throw std::runtime_error("Simulation.WH and Simulation.dt differ from Simulation::set_world");
+    }
+    // "seed" is injected by main if not given
+    const auto& js = J["Simulation"];
+    seed_ = js.contains("seed") ? js["seed"].get<uint64_t>() : uint64_t(std::random_device{}());
+    reng = rndutils::make_random_engine<>(seed_);     // initial conditions
     float flock_threshold = J["Simulation"]["flockDetection"]["threshold"];
     flock_dd_ = flock_threshold * flock_threshold;
     flock_update_ = 0;
     flock_interval_ = time2tick(J["Simulation"]["flockDetection"]["interval"]);
+    reorder_update_ = 0;
+    reorder_interval_ = time2tick(neighbors_config(J).value("reorder", 0.0));
     init_simulation_state(J, species_, state_, *this);
   }
 
 
+  void Simulation::set_world(const json& J)
+  {
+    WH_ = J["Simulation"]["WH"];
+    dt_ = J["Simulation"]["dt"];
+  }
+
+
   Simulation::~Simulation()
   {
   }
@@ -271,8 +686,11 @@ namespace model {
 
   void Simulation::update(Observer* observer)
   {
+    phase_timer tick_timer(profiler_);
+    trace::scope _("tick", "simulation", tick_);
     {
-      std::lock_guard<std::recursive_mutex> _(mutex_);
+      trace::lock<std::recursive_mutex> _(mutex_, "Simulation::mutex_");
+      begin_tick();
       update_species<0>(this, species_, state_);
       if (flock_update_ == tick_) {
         integrate_species_flock<0>(this, species_, state_, flock_dd_);
@@ -281,25 +699,178 @@ namespace model {
       else {
         integrate_species<0>(this, species_, state_);
       }
-      ++tick_;
+      end_tick();
+    }
+    phase_timer timer(profiler_);
+    {
+      trace::scope _("observers", "simulation");
+      notify_observer(observer, Tick, this);
+    }
+    timer.lap(tick_phase::observers);
+    tick_timer.lap(tick_phase::tick);
+    profiler_.end_tick(tick_);
+  }
+
+
+  void Simulation::begin_tick()
+  {
+    if (reorder_interval_ && reorder_update_ == tick_) {
+      phase_timer timer(profiler_);
+      trace::scope _("reorder", "simulation");
+      reorder_species<0>(this, species_, state_);
+      reorder_update_ += reorder_interval_;
+      timer.lap(tick_phase::reorder);
     }
-    notify_observer(observer, Tick, this);
+    for (auto& sa : state_) {
+      sa.alive = std::count_if(sa.update_times.cbegin(), sa.update_times.cend(), [](auto ut) { return ut != static_cast<tick_t>(-1); });
+    }
+  }
+
+
+  void Simulation::end_tick()
+  {
+    ++tick_;
+    if (publishing_.load(std::memory_order_acquire)) {
+      publish();
+    }
+  }
+
+
+  void Simulation::scan_beyond_view_impl(size_t idx, size_t S, std::vector<neighbor_info>& out) const
+  {
+    scan_beyond_row<0>(this, S, idx, state_, out);
+  }
+
+
+  // copies the rendering state into the back buffer and swaps it in
+  void Simulation::publish()
+  {
+    auto& frame = frames_.back();
+    frame.tick = tick_;
+    publish_all<0>(this, frame, publish_cm_);
+    frames_.publish();
   }
 
 
   void Simulation::set_snapshots(const species_snapshots& ss)
   {
-    std::lock_guard<std::recursive_mutex> _(mutex_);
+    trace::lock<std::recursive_mutex> _(mutex_, "Simulation::mutex_");
     set_snapshot<0>(this, species_, ss);
+    for (auto& sa : state_) {
+      sa.verlet.invalidate();
+    }
   }
 
 
   species_snapshots Simulation::get_snapshots() const
   {
-    std::lock_guard<std::recursive_mutex> _(mutex_);
+    trace::lock<std::recursive_mutex> _(mutex_, "Simulation::mutex_");
     species_snapshots res;
     get_snapshot<0>(this, species_, res);
     return res;
   }
 
+
+  lockstep::lockstep(std::vector<Simulation*> sims)
+  {
+    if (sims.empty()) throw std::runtime_error("lockstep without replicates");
+    for (auto* sim : sims) {
+      reps_.push_back({ sim, &sim->species_, &sim->state_, false });
+    }
+    active_.reserve(reps_.size());
+  }
+
+
+  bool lockstep::terminated() const noexcept
+  {
+    return std::all_of(reps_.cbegin(), reps_.cend(), [](const auto& rep) { return rep.sim->terminated(); });
+  }
+
+
+  void lockstep::initialize(const std::vector<Observer*>& observers, const species_snapshots& ss)
+  {
+    for (size_t r = 0; r < reps_.size(); ++r) {
+      reps_[r].sim->initialize(observers[r], ss);
+    }
+    const auto* first = reps_.front().sim;
+    for (size_t S = 0; S < n_species; ++S) {
+      const auto n = first->state_[S].update_times.size();
+      for (const auto& rep : reps_) {
+        if ((*rep.sa)[S].update_times.size() != n || rep.sim->tick() != first->tick()) {
+          throw std::runtime_error("lockstep replicates shall have the same population sizes");
+        }
+      }
+    }
+  }
+
+
+  template <size_t S>
+  void lockstep::integrate_species()
+  {
+    const size_t blocks = std::get<S>(*active_.front()->sa).kinematics.blocks();
+    for (auto* rep : active_) {
+      auto& s = std::get<S>(*rep->sa);
+      if (rep->flock_tick) s.flock_tracker.prepare(s.kinematics.size());
+    }
+    // one loop over the blocks of all replicates
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, active_.size() * blocks, integrate_grain / kinematic_store::width), [&](const auto& r) {
+      trace::scope _("integrate", std::tuple_element_t<S, species_pop>::value_type::name(), r.size());
+      for (auto b = r.begin(); b < r.end();) {
+        const auto a = b / blocks;
+        const auto end = std::min(r.end(), (a + 1) * blocks);
+        auto* rep = active_[a];
+        auto& s = std::get<S>(*rep->sa);
+        integrate_range<S>(*rep->sa, tbb::blocked_range<size_t>(b - a * blocks, end - a * blocks), [&](size_t i) {
+          s.verlet.track(i, s.kinematics.pos(i), Simulation::WH());
+          if (rep->flock_tick) s.flock_tracker.feed(s.kinematics, i);
+        });
+        b = end;
+      }
+    });
+    integrate_species<S + 1>();
+    for (auto* rep : active_) {
+      auto& fts = std::get<S>(*rep->sa).flock_tracker;
+      if (rep->flock_tick) {
+        fts.cluster(rep->sim->flock_dd_, rep->sim->tick());
+      }
+      else {
+        fts.track();
+      }
+    }
+  }
+
+  template <>
+  void lockstep::integrate_species<model::n_species>()
+  {}
+
+
+  void lockstep::update(const std::vector<Observer*>& observers)
+  {
+    active_.clear();
+    for (auto& rep : reps_) {
+      if (!rep.sim->terminated()) active_.push_back(&rep);
+    }
+    if (active_.empty()) return;
+    trace::scope _("lockstep tick", "simulation", tick());
+    {
+      std::vector<std::unique_lock<std::recursive_mutex>> locks;
+      for (auto* rep : active_) {
+        auto* sim = rep->sim;
+        locks.emplace_back(sim->mutex_);
+        sim->begin_tick();
+        model::update_species<0>(sim, *rep->pop, *rep->sa);
+        rep->flock_tick = (sim->flock_update_ == sim->tick_);
+      }
+      integrate_species<0>();
+      for (auto* rep : active_) {
+        auto* sim = rep->sim;
+        if (rep->flock_tick) sim->flock_update_ += sim->flock_interval_;
+        sim->end_tick();
+      }
+    }
+    for (auto* rep : active_) {
+      notify_observer(observers[static_cast<size_t>(rep - reps_.data())], Simulation::Tick, rep->sim);
+    }
+  }
+
 }
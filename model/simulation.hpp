@@ -5,6 +5,13 @@
 #include <atomic>
 #include "model/json.hpp"
 #include "flock.hpp"
+#include "neighbor_grid.hpp"
+#include "update_queue.hpp"
+#include "kinematics.hpp"
+#include "published_state.hpp"
+#include "rng.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
 
 
 namespace model {
@@ -36,6 +43,11 @@ namespace model {
     static float WH() noexcept { return WH_; }
     static float dt() noexcept { return dt_; }      // [s]
 
+    // sets WH and dt from J, shared by all simulations of the process.
+    // Shall be called before the first Simulation is constructed and not
+    // while simulations are constructed or running (ensemble).
+    static void set_world(const json& J);
+
     tick_t tick() const noexcept { return tick_; }  // [1]
     tick_t time2tick(double time) const noexcept { return static_cast<tick_t>(time / dt_); }  // [1]
     double time() const noexcept { return static_cast<double>(dt_) * tick_; }                 // [s]
@@ -49,13 +61,123 @@ namespace model {
       return std::get<Tag::value>(species_);
     }
 
-    // returns exclusive (alive) neighborhood sorted by distance
+    // returns exclusive (alive) neighborhood sorted by distance,
+    // limited to the top-K nearest neighbors within the interaction radius.
+    // The actions read this view, see scan_beyond_view.
     template <typename Tag, typename OtherTag = Tag>
     neighbor_info_view sorted_view(size_t idx) const noexcept
     {
       return sorted_view_impl(idx, Tag::value, OtherTag::value);
     }
 
+    // neighborhood as requested by require_view or require_full_view,
+    // the sorted view if nothing wider was requested.
+    // The observer rows are kept apart from the rows the actions read,
+    // thus observing doesn't change the dynamics.
+    template <typename Tag, typename OtherTag = Tag>
+    neighbor_info_view observed_view(size_t idx) const noexcept
+    {
+      const auto& s = state_[Tag::value];
+      const auto k = s.obs_k[OtherTag::value];
+      if (k == 0) return sorted_view_impl(idx, Tag::value, OtherTag::value);
+      return { s.ONI[OtherTag::value].data() + idx * k, s.ONN[OtherTag::value][idx] };
+    }
+
+    // true if observed_view differs from sorted_view
+    template <typename Tag, typename OtherTag = Tag>
+    bool widened_view() const noexcept
+    {
+      return state_[Tag::value].obs_k[OtherTag::value] != 0;
+    }
+
+    // the observed view of the Tag-OtherTag neighborhood will hold all
+    // alive individuals instead of the nearest ones within the interaction radius.
+    // Shall be called before the first update.
+    template <typename Tag, typename OtherTag = Tag>
+    void require_full_view() const
+    {
+      trace::lock<std::recursive_mutex> _(mutex_, "Simulation::mutex_");
+      auto& s = state_[Tag::value];
+      const auto n = state_[OtherTag::value].update_times.size();
+      s.obs_full[OtherTag::value] = true;
+      s.obs_k[OtherTag::value] = n;
+      s.ONI[OtherTag::value].assign(s.update_times.size() * n, neighbor_info{});
+      s.ONN[OtherTag::value].assign(s.update_times.size(), 0);
+    }
+
+    // requests at least the k nearest alive individuals within radius
+    // in the Tag-OtherTag observed view. Widens the observer rows if the
+    // cell list covers radius, falls back to require_full_view otherwise.
+    // Shall be called before the first update.
+    template <typename Tag, typename OtherTag = Tag>
+    void require_view(size_t k, float radius) const
+    {
+      trace::lock<std::recursive_mutex> _(mutex_, "Simulation::mutex_");
+      auto& s = state_[Tag::value];
+      const auto& so = state_[OtherTag::value];
+      const bool covered = (Tag::value != OtherTag::value) || !so.grid.active() || (radius * radius <= so.grid.radius2());
+      if (!covered) {
+        require_full_view<Tag, OtherTag>();
+        return;
+      }
+      k = std::min(k, so.update_times.size());
+      if (s.obs_full[OtherTag::value] || k <= std::max(s.topk[OtherTag::value], s.obs_k[OtherTag::value])) return;
+      s.obs_k[OtherTag::value] = k;
+      s.ONI[OtherTag::value].assign(s.update_times.size() * k, neighbor_info{});
+      s.ONN[OtherTag::value].assign(s.update_times.size(), 0);
+    }
+
+    // the alive individuals of the own species within the interaction
+    // radius of idx that didn't fit into its top-K row, sorted by distance.
+    // Empty if the row holds all of them. Fallback for actions that skip
+    // neighbors and run out of the sorted view (model/perception.hpp).
+    // Safe to call from the update of idx.
+    template <typename Tag>
+    void scan_beyond_view(size_t idx, std::vector<neighbor_info>& out) const
+    {
+      scan_beyond_view_impl(idx, Tag::value, out);
+    }
+
+    // counter-based random engine of individual idx for tick T.
+    // keyed by run seed, species, external id, tick and stream, thus the
+    // draws don't depend on the thread count or the partitioning.
+    template <typename Tag>
+    philox4x32 rng(size_t idx, tick_t T, rng_stream stream) const noexcept
+    {
+      return philox4x32(seed_,
+                        static_cast<uint32_t>(id<Tag>(idx)),
+                        static_cast<uint32_t>(Tag::value << 16) | static_cast<uint32_t>(stream),
+                        static_cast<uint32_t>(T));
+    }
+
+    uint64_t seed() const noexcept { return seed_; }
+
+    // number of individual updates (neighbor search and actions) since start
+    template <typename Tag>
+    uint64_t updates() const noexcept
+    {
+      return state_[Tag::value].updates;
+    }
+
+    // per-phase timings of the ticks, simulation thread only
+    tick_profiler& profiler() const noexcept { return profiler_; }
+
+    // stable external id of individual idx.
+    // the index of an individual changes if the population is
+    // reordered along the Hilbert curve (neighbors.reorder).
+    template <typename Tag>
+    size_t id(size_t idx) const noexcept
+    {
+      return state_[Tag::value].ids[idx];
+    }
+
+    // current index of the individual with external id
+    template <typename Tag>
+    size_t idx_of(size_t id) const noexcept
+    {
+      return state_[Tag::value].slots[id];
+    }
+
     template <typename Tag>
     const size_t& are_alive() const noexcept
     {
@@ -80,16 +202,32 @@ namespace model {
       return state_[Tag::value].flock_tracker.id_of(idx);
     }
 
+    // split and merge events of the last flock detection
+    template <typename Tag>
+    const std::vector<flock_event>& flock_events() const noexcept
+    {
+      return state_[Tag::value].flock_tracker.events();
+    }
+
+    template <typename Tag>
+    flock_members_view flock_members(size_t flock_id) const noexcept
+    {
+      return state_[Tag::value].flock_tracker.members(flock_id);
+    }
+
     template <typename Tag>
     std::vector<int> flock_mates(size_t flock_id) const
     {
-      auto fm = std::vector<int>{};
-      for (size_t i = 0; i < state_[Tag::value].flock_tracker.pop_size(); ++i) {
-        if (flock_of<Tag>(i) == flock_id) {
-          fm.push_back(static_cast<int>(i));
-        }
-      }
-      return fm;
+      const auto fm = flock_members<Tag>(flock_id);
+      return std::vector<int>(fm.cbegin(), fm.cend());
+    }
+
+    // sums over the flocks at the current positions, simulation thread only
+    template <typename Tag>
+    const std::vector<model::flock_sums>& flock_sums() const
+    {
+      auto& s = state_[Tag::value];
+      return s.flock_tracker.sums(s.kinematics, s.update_times, tick_, WH_);
     }
 
     // Access from foreign threads
@@ -97,11 +235,29 @@ namespace model {
     void terminate() const noexcept { terminate_.store(true, std::memory_order_release); }
     bool terminated() const noexcept { return terminate_.load(std::memory_order_acquire); }
 
-    // calls fun for all individuals, internally synchronized
+    // requests the publication of the rendering state of species Tag
+    // after every tick, see published()
+    template <typename Tag>
+    void request_publication(long long color_map) const noexcept
+    {
+      publish_cm_[Tag::value].store(color_map, std::memory_order_relaxed);
+      publishing_.store(true, std::memory_order_release);
+    }
+
+    // latest completed frame or nullptr, lock-free.
+    // single reader: the frame stays valid until the next call.
+    const published_frame* published() const noexcept
+    {
+      return frames_.front();
+    }
+
+    // Access from the simulation thread (observers)
+    // not synchronized with update(), foreign threads shall read published()
+
+    // calls fun for all individuals
     template <typename Tag, typename Fun>
     size_t visit_all(Fun&& fun) const
     {
-      std::lock_guard<std::recursive_mutex> _(mutex_);
       auto& pop = std::get<Tag::value>(species_);
       size_t n = 0;
       for (size_t i = 0; i < pop.size(); ++i) {
@@ -111,11 +267,10 @@ namespace model {
       return n;
     }
 
-    // calls fun for all alive individuals, internally synchronized
+    // calls fun for all alive individuals
     template <typename Tag, typename Fun>
     size_t visit(Fun&& fun) const
     {
-      std::lock_guard<std::recursive_mutex> _(mutex_);
       auto& pop = std::get<Tag::value>(species_);
       size_t n = 0;
       for (size_t i = 0; i < pop.size(); ++i) {
@@ -126,11 +281,19 @@ namespace model {
       return n;
     }
 
-    // calls fun for individual idx if alive, internally synchronized
+    // visit under the simulation lock, for foreign threads (GUI)
+    // that need more than published()
+    template <typename Tag, typename Fun>
+    size_t visit_locked(Fun&& fun) const
+    {
+      trace::lock<std::recursive_mutex> _(mutex_, "Simulation::mutex_");
+      return visit<Tag>(std::forward<Fun>(fun));
+    }
+
+    // calls fun for individual idx if alive
     template <typename Tag, typename Fun>
     size_t visit(size_t idx, Fun&& fun) const
     {
-      std::lock_guard<std::recursive_mutex> _(mutex_);
       auto& pop = std::get<Tag::value>(species_);
       assert(idx < pop.size());
       size_t n = 0;
@@ -143,7 +306,6 @@ namespace model {
     template <typename Tag>
     bool is_alive(size_t idx) const noexcept
     {
-      std::lock_guard<std::recursive_mutex> _(mutex_);
       return (state_[Tag::value].update_times[idx] != static_cast<tick_t>(-1));
     }
 
@@ -151,13 +313,16 @@ namespace model {
     template <typename Tag>
     void set_alive(bool alive) const
     {
-      std::lock_guard<std::recursive_mutex> _(mutex_);
+      trace::lock<std::recursive_mutex> _(mutex_, "Simulation::mutex_");
+      state_[Tag::value].verlet.invalidate();
       if (alive) {
-        auto reng = rndutils::make_random_engine_low_entropy<>();
         auto udist = std::uniform_real_distribution<>(0.0, 1.0 / double(dt_));
-        for (auto& ut : state_[Tag::value].update_times) {
-          ut = tick_ + static_cast<tick_t>(udist(reng));
+        auto& update_times = state_[Tag::value].update_times;
+        for (size_t idx = 0; idx < update_times.size(); ++idx) {
+          auto rng = this->rng<Tag>(idx, tick_, rng_stream::revive);
+          update_times[idx] = tick_ + static_cast<tick_t>(udist(rng));
         }
+        state_[Tag::value].queue.assign(state_[Tag::value].update_times, tick_);
         return;
       }
       for (auto& ut : state_[Tag::value].update_times) {
@@ -169,11 +334,14 @@ namespace model {
     template <typename Tag>
     void set_alive(size_t idx, bool alive) const
     {
-      std::lock_guard<std::recursive_mutex> _(mutex_);
+      trace::lock<std::recursive_mutex> _(mutex_, "Simulation::mutex_");
       assert(idx < state_[Tag::value].update_times.size());
+      state_[Tag::value].verlet.invalidate();
       if (alive) {
-        auto reng = rndutils::make_random_engine_low_entropy<>();
-        state_[Tag::value].update_times[idx] = tick_ + static_cast<tick_t>(std::uniform_real_distribution<>(0.0, 1.0 / double(dt_))(reng));
+        auto rng = this->rng<Tag>(idx, tick_, rng_stream::revive);
+        auto& ut = state_[Tag::value].update_times[idx];
+        ut = tick_ + static_cast<tick_t>(std::uniform_real_distribution<>(0.0, 1.0 / double(dt_))(rng));
+        state_[Tag::value].queue.push(idx, ut, tick_);
         return;
       }
       state_[Tag::value].update_times[idx] = static_cast<tick_t>(-1);
@@ -189,37 +357,58 @@ namespace model {
     // returns exclusive (alive) neighborhood sorted by distance
     neighbor_info_view sorted_view_impl(size_t idx, size_t S1, size_t S2) const noexcept
     {
-      const auto alive = state_[S2].alive;
-      const auto n = state_[S2].update_times.size();
-      if (alive) {
-        const auto first = &state_[S1].NI[S2][idx * n + (n - alive)];
-        if (S1 == S2) {
-          return neighbor_info_view{ first + 1, alive - 1 };
-        }
-        return { first, alive };
-      }
-      return { nullptr, 0 };
+      const auto& s = state_[S1];
+      return { s.NI[S2].data() + idx * s.topk[S2], s.NN[S2][idx] };
     }
 
+    void scan_beyond_view_impl(size_t idx, size_t S, std::vector<neighbor_info>& out) const;
+
 
   private:
     tick_t tick_ = 0;
     tick_t flock_update_ = 0;
     tick_t flock_interval_ = 0;
+    tick_t reorder_update_ = 0;
+    tick_t reorder_interval_ = 0;
     float flock_dd_ = 0.f;
+    uint64_t seed_ = 0;                       // run seed
     mutable std::recursive_mutex mutex_;      // simulation lock
     mutable species_pop species_;
     mutable std::atomic<bool> terminate_ = false;
+    mutable std::atomic<bool> publishing_ = false;
+    mutable std::array<std::atomic<long long>, n_species> publish_cm_ = {};
+    mutable triple_buffer<published_frame> frames_;
+    mutable tick_profiler profiler_;
 
     struct state_t
     {
       size_t alive;   // number of alive ind
+      uint64_t updates = 0;                                   // individual updates since start
       std::vector<tick_t> update_times;
-      std::array<std::vector<neighbor_info>, n_species> NI;   // neighbor info matrices
+      std::vector<unsigned> ids;                              // external id of individual
+      std::vector<unsigned> slots;                            // individual of external id
+      std::array<std::vector<neighbor_info>, n_species> NI;   // neighbor info matrices, topk per row
+      std::array<std::vector<unsigned>, n_species> NN;        // number of neighbors per row
+      std::array<size_t, n_species> topk = {};                // row capacity
+      std::array<std::vector<neighbor_info>, n_species> ONI;  // observer rows, obs_k per row
+      std::array<std::vector<unsigned>, n_species> ONN;       // number of neighbors per observer row
+      std::array<size_t, n_species> obs_k = {};               // observer row capacity, 0: none
+      std::array<bool, n_species> obs_full = {};              // observer rows hold all alive
+      torus_grid grid;                                        // cell list, own species
+      verlet_list verlet;                                     // skin lists, own species
+      update_queue queue;                                     // calendar queue over update_times
+      kinematic_store kinematics;                             // kinematic state of the individuals
       flock_tracker flock_tracker;
     };
     mutable std::array<state_t, n_species> state_;
     friend class flock_tracker;
+    friend class lockstep;
+
+    // the parts of update around neighbor search, actions and integration,
+    // the lock shall be held
+    void begin_tick();
+    void end_tick();
+    void publish();
 
    public:
      using state_array = decltype(state_);
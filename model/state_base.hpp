@@ -3,6 +3,7 @@
 
 #include "simulation.hpp"
 #include "model/flight.hpp"
+#include "model/action_base.hpp"
 
 
 namespace model {
@@ -81,14 +82,20 @@ protected: \
   using action_tuple = typename action_pack::package_tuple; \
   action_tuple actions; \
   float all_ws = 0.f; \
+  using fused_pass = ::model::actions::fused_pass<action_tuple>; \
+  void run_actions(agent_type* self, size_t idx, tick_t T, const Simulation& sim) \
+  { \
+    fused_pass fused(actions, self, sim); \
+    chain_actions<0>(fused, self, idx, T, sim); \
+  } \
   template <size_t I> \
-  void chain_actions(agent_type* self, size_t idx, tick_t T, const Simulation& sim) \
+  void chain_actions(fused_pass& fused, agent_type* self, size_t idx, tick_t T, const Simulation& sim) \
   { \
-    std::get<I>(actions)(self, idx, T, sim); \
-    chain_actions<I + 1>(self, idx, T, sim); \
+    fused.template invoke<I>(actions, self, idx, T, sim); \
+    chain_actions<I + 1>(fused, self, idx, T, sim); \
   } \
   template <> \
-  void chain_actions<action_pack::size>(agent_type*, size_t, tick_t T, const Simulation& sim) \
+  void chain_actions<action_pack::size>(fused_pass&, agent_type*, size_t, tick_t T, const Simulation& sim) \
   { \
   } \
  template <size_t I> \
@@ -0,0 +1,214 @@
+#ifndef MODEL_TRACE_HPP_INCLUDED
+#define MODEL_TRACE_HPP_INCLUDED
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <filesystem>
+#include <stdexcept>
+
+
+// Timeline tracer, Chrome trace-event format (chrome://tracing, ui.perfetto.dev).
+// Every thread records complete events (name, category, begin, duration)
+// into its own ring buffer, the newest 'capacity' events per thread survive.
+// Recording takes no lock; the buffers are registered once per thread.
+// Disabled, a scope costs one relaxed load.
+namespace model::trace {
+
+
+  struct event
+  {
+    const char* name;       // static or interned
+    const char* cat;
+    int64_t begin;          // [ns] since enable()
+    int64_t dur;            // [ns]
+    int64_t arg;            // < 0: none
+  };
+
+
+  namespace detail {
+
+    using clock = std::chrono::steady_clock;
+
+    // single writer ring buffer of one thread
+    struct ring
+    {
+      ring(size_t capacity, unsigned tid) : events(capacity), tid(tid) {}
+
+      void push(const event& e) noexcept
+      {
+        const auto h = head.load(std::memory_order_relaxed);
+        events[h & (events.size() - 1)] = e;
+        head.store(h + 1, std::memory_order_release);
+      }
+
+      std::vector<event> events;
+      std::atomic<uint64_t> head = 0;
+      const unsigned tid;
+      std::string thread_name;
+    };
+
+    inline std::atomic<bool> enabled = false;
+    inline size_t capacity = 0;                       // power of 2
+    inline clock::time_point epoch;
+    inline std::mutex registry_mutex;                 // rings and names
+    inline std::vector<std::unique_ptr<ring>> rings;  // outlive their threads
+    inline std::deque<std::string> names;             // interned
+    inline thread_local ring* this_ring = nullptr;
+
+    inline int64_t now() noexcept
+    {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - epoch).count();
+    }
+
+    inline ring& get_ring()
+    {
+      if (!this_ring) {
+        std::lock_guard<std::mutex> _(registry_mutex);
+        rings.push_back(std::make_unique<ring>(capacity, static_cast<unsigned>(rings.size())));
+        this_ring = rings.back().get();
+      }
+      return *this_ring;
+    }
+
+  }
+
+
+  inline bool enabled() noexcept
+  {
+    return detail::enabled.load(std::memory_order_relaxed);
+  }
+
+  // shall be called before the traced threads start, capacity: events per thread
+  inline void enable(size_t capacity)
+  {
+    size_t c = 1;
+    while (c < capacity) c <<= 1;
+    detail::capacity = c;
+    detail::epoch = detail::clock::now();
+    detail::enabled.store(true, std::memory_order_release);
+  }
+
+  // stable copy of name, for event names that are not literals
+  inline const char* intern(const std::string& name)
+  {
+    std::lock_guard<std::mutex> _(detail::registry_mutex);
+    return detail::names.emplace_back(name).c_str();
+  }
+
+  // names the calling thread in the trace
+  inline void name_thread(const std::string& name)
+  {
+    if (enabled()) {
+      auto& r = detail::get_ring();
+      std::lock_guard<std::mutex> _(detail::registry_mutex);
+      r.thread_name = name;
+    }
+  }
+
+  inline void record(const char* name, const char* cat, int64_t begin, int64_t dur, int64_t arg = -1)
+  {
+    detail::get_ring().push({ name, cat, begin, dur, arg });
+  }
+
+
+  // records the enclosing scope as complete event
+  class scope
+  {
+  public:
+    scope(const char* name, const char* cat, int64_t arg = -1) noexcept
+    {
+      if (enabled()) {
+        name_ = name;
+        cat_ = cat;
+        arg_ = arg;
+        begin_ = detail::now();
+      }
+    }
+
+    ~scope()
+    {
+      if (name_) record(name_, cat_, begin_, detail::now() - begin_, arg_);
+    }
+
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
+
+  private:
+    const char* name_ = nullptr;
+    const char* cat_ = nullptr;
+    int64_t arg_ = -1;
+    int64_t begin_ = 0;
+  };
+
+
+  // lock_guard that records waits for the mutex longer than 1us
+  template <typename Mutex>
+  class lock
+  {
+  public:
+    lock(Mutex& mutex, const char* name) : mutex_(mutex)
+    {
+      if (!enabled()) {
+        mutex_.lock();
+        return;
+      }
+      const auto t0 = detail::now();
+      mutex_.lock();
+      const auto wait = detail::now() - t0;
+      if (wait > 1000) record(name, "lock", t0, wait);
+    }
+
+    ~lock()
+    {
+      mutex_.unlock();
+    }
+
+    lock(const lock&) = delete;
+    lock& operator=(const lock&) = delete;
+
+  private:
+    Mutex& mutex_;
+  };
+
+
+  // writes the recorded events as trace-event json.
+  // the traced threads shall be done (joined or idle).
+  inline void write(const std::filesystem::path& file)
+  {
+    std::ofstream os(file);
+    if (!os) throw std::runtime_error("can't create '" + file.string() + "'");
+    std::lock_guard<std::mutex> _(detail::registry_mutex);
+    os << std::fixed << std::setprecision(3);     // [us]
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    auto sep = [&]() { os << (first ? "" : ",\n"); first = false; };
+    for (const auto& r : detail::rings) {
+      const auto name = r->thread_name.empty() ? "thread " + std::to_string(r->tid) : r->thread_name;
+      sep();
+      os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << r->tid << ",\"args\":{\"name\":\"" << name << "\"}}";
+      const auto head = r->head.load(std::memory_order_acquire);
+      const auto n = std::min<uint64_t>(head, r->events.size());
+      for (auto i = head - n; i < head; ++i) {
+        const auto& e = r->events[i & (r->events.size() - 1)];
+        sep();
+        os << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.cat << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << r->tid
+           << ",\"ts\":" << 1e-3 * e.begin << ",\"dur\":" << 1e-3 * e.dur;
+        if (e.arg >= 0) os << ",\"args\":{\"n\":" << e.arg << "}";
+        os << '}';
+      }
+    }
+    os << "\n]}\n";
+  }
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef MODEL_UPDATE_QUEUE_HPP_INCLUDED
+#define MODEL_UPDATE_QUEUE_HPP_INCLUDED
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "model.hpp"
+
+
+namespace model {
+
+
+  // calendar queue over update times.
+  // ring of buckets indexed by tick; entries further ahead than
+  // one lap stay in their bucket until their lap comes.
+  // update_times[idx] remains the reference: entries that don't
+  // match it anymore are silently dropped.
+  class update_queue
+  {
+  public:
+    update_queue() = default;
+
+    // ring of at least 'horizon' ticks
+    void reset(size_t N, tick_t horizon)
+    {
+      size_t n = 1;
+      while (n < horizon + 1) n <<= 1;
+      mask_ = n - 1;
+      buckets_.assign(n, {});
+      drained_.assign(N, static_cast<tick_t>(-1));
+      due_.clear();
+    }
+
+    // enqueues individual idx for update at tick ut.
+    // overdue update times are scheduled for tick T.
+    void push(size_t idx, tick_t ut, tick_t T)
+    {
+      if (ut == static_cast<tick_t>(-1)) return;    // dead
+      buckets_[std::max(ut, T) & mask_].emplace_back(static_cast<unsigned>(idx), ut);
+    }
+
+    // re-enqueues all individuals
+    template <typename UT>
+    void assign(const UT& update_times, tick_t T)
+    {
+      for (auto& bucket : buckets_) bucket.clear();
+      for (size_t i = 0; i < update_times.size(); ++i) {
+        push(i, update_times[i], T);
+      }
+    }
+
+    // returns the compacted list of individuals due at tick T
+    template <typename UT>
+    const std::vector<unsigned>& drain(const UT& update_times, tick_t T)
+    {
+      due_.clear();
+      auto& bucket = buckets_[T & mask_];
+      size_t keep = 0;
+      for (size_t e = 0; e < bucket.size(); ++e) {
+        const auto entry = bucket[e];
+        const auto idx = entry.first;
+        if (entry.second != update_times[idx]) continue;   // rescheduled or dead
+        if (entry.second > T) {
+          bucket[keep++] = entry;                           // next lap
+        }
+        else if (drained_[idx] != T) {
+          drained_[idx] = T;
+          due_.push_back(idx);
+        }
+      }
+      bucket.resize(keep);
+      return due_;
+    }
+
+  private:
+    size_t mask_ = 0;
+    std::vector<std::vector<std::pair<unsigned, tick_t>>> buckets_;   // (idx, update time)
+    std::vector<tick_t> drained_;   // last tick idx was drained
+    std::vector<unsigned> due_;
+  };
+
+}
+
+#endif
@@ -21,8 +21,8 @@ namespace model {
   {
     if (nidist2 != 0.0f && nidist2 < act->maxdist2)
     {
-      const auto offs = torus::ofs(Simulation::WH(), self->pos, nipos);
-      if (glm::dot(self->dir, offs) > glm::sqrt(nidist2) * act->cfov)
+      const auto offs = torus::ofs(Simulation::WH(), self->pos(), nipos);
+      if (glm::dot(self->dir(), offs) > glm::sqrt(nidist2) * act->cfov)
       {
         return true;
       }
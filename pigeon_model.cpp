@@ -2,9 +2,13 @@
 #include <iostream>
 #include <future>
 #include <thread>
+#include <random>
+#include <fstream>
+#include <utility>
 #include <tbb/tbb.h>
 #include "model/json.hpp"
 #include "model/model.hpp"
+#include "model/lockstep.hpp"
 #include "agents/agents.hpp"
 #ifdef WIN32
 # include "simgl/AppWin.h"
@@ -13,18 +17,21 @@
 #include <libs/cmd_line.h>
 
 
-// model thread function
-void run_simulation(model::Simulation* sim, 
-                    const species_snapshots& ss,
-                    model::Observer* observer, 
-					          //analysis::DataExporter* dataexp,
-                    const json& J)
+int num_threads(const json& J)
+{
+  int numThreads = J["Simulation"]["numThreads"];
+  if (numThreads == -1) numThreads = tbb::task_scheduler_init::default_num_threads();
+  return std::clamp(numThreads, 1, tbb::task_scheduler_init::default_num_threads());
+}
+
+
+// runs sim until Tmax or termination
+void simulate(model::Simulation* sim,
+              const species_snapshots& ss,
+              model::Observer* observer,
+              const json& J)
 {
   try {
-    int numThreads = J["Simulation"]["numThreads"];
-    if (numThreads == -1) numThreads = tbb::task_scheduler_init::default_num_threads();
-    numThreads = std::clamp(numThreads, 1, tbb::task_scheduler_init::default_num_threads());
-    tbb::task_scheduler_init tbb_init(numThreads);
     auto Tmax = sim->time2tick(double(J["Simulation"]["Tmax"]));
     sim->initialize(observer, ss);
     while (!sim->terminated()) {
@@ -33,6 +40,7 @@ void run_simulation(model::Simulation* sim,
         break;
       }
     }
+    sim->profiler().flush(sim->tick());
     observer->notify(model::Simulation::Finished, *sim);
   }
   catch (std::exception& err) {
@@ -42,6 +50,48 @@ void run_simulation(model::Simulation* sim,
 }
 
 
+// runs the replicates of ls in lockstep until Tmax or termination
+void simulate_lockstep(model::lockstep& ls,
+                       const species_snapshots& ss,
+                       const std::vector<model::Observer*>& observers,
+                       const json& J)
+{
+  auto finish = [&]() {
+    for (size_t r = 0; r < ls.size(); ++r) {
+      observers[r]->notify(model::Simulation::Finished, *ls[r]);
+    }
+  };
+  try {
+    auto Tmax = ls[0]->time2tick(double(J["Simulation"]["Tmax"]));
+    ls.initialize(observers, ss);
+    while (!ls.terminated()) {
+      ls.update(observers);
+      if (ls.tick() == Tmax) {
+        break;
+      }
+    }
+    finish();
+  }
+  catch (std::exception& err) {
+    finish();
+    std::cerr << err.what() << '\n';
+  }
+}
+
+
+// model thread function
+void run_simulation(model::Simulation* sim, 
+                    const species_snapshots& ss,
+                    model::Observer* observer, 
+					          //analysis::DataExporter* dataexp,
+                    const json& J)
+{
+  tbb::task_scheduler_init tbb_init(num_threads(J));
+  model::trace::name_thread("simulation");
+  simulate(sim, ss, observer, J);
+}
+
+
 // should come from file or something...
 const static species_snapshots initial_snapshot = {
   {},                                  // pigeons
@@ -49,11 +99,37 @@ const static species_snapshots initial_snapshot = {
 };
 
 
-void run(json& J, bool headless)
+template <size_t... S>
+std::array<const char*, model::n_species + 1> species_names(std::index_sequence<S...>)
+{
+  return { std::tuple_element_t<S, model::species_pop>::value_type::name()..., "all" };
+}
+
+
+// per-phase timings into a csv file every 'interval' simulated seconds
+void profile_to(const model::Simulation& sim, std::ofstream& os, double interval)
 {
+  static const auto names = species_names(std::make_index_sequence<model::n_species>());
+  sim.profiler().enable(sim.time2tick(interval), [&os](const model::tick_profiler& prof, model::tick_t T) {
+    prof.write_csv(os, T, model::Simulation::dt(), names);
+  });
+}
+
+
+void run(json& J, bool headless, const std::filesystem::path& profile_file, double profile_interval)
+{
+  std::ofstream profile_os;
+  if (!profile_file.empty()) {
+    profile_os.open(profile_file);
+    if (!profile_os) throw std::runtime_error("can't create '" + profile_file.string() + "'");
+    model::tick_profiler::write_csv_header(profile_os);
+  }
   model::species_snapshots ss = initial_snapshot;
   for (;;) {
     auto sim = std::make_unique<model::Simulation>(J);
+    if (profile_os.is_open()) {
+      profile_to(*sim, profile_os, profile_interval);
+    }
     auto observers = analysis::CreateObserverChain<model::pigeon_tag>(J);
     if (headless) {
       auto observer  = std::make_unique<Observer>();
@@ -85,6 +161,93 @@ void run(json& J, bool headless)
 }
 
 
+// ensemble mode: runs every sweep point 'replicates' times, concurrently
+// inside this process. Each run executes in its own task arena of the
+// shared thread pool and writes into its own sub folder of one
+// ensemble folder. WH and dt are static and can't be swept.
+// Replicate r of a sweep point runs with seed + r.
+// With 'lockstep', the replicates of a sweep point run in lockstep (model/lockstep.hpp)
+// on run_threads threads instead of as independent runs.
+void run_ensemble(const json& J, int replicates, const std::filesystem::path& sweep_file, int run_threads, bool lockstep)
+{
+  std::vector<json> points;
+  if (!sweep_file.empty()) {
+    const auto sweep = uncomment_json(sweep_file);
+    if (!sweep.is_array()) throw std::runtime_error("sweep file shall hold an array of config patches");
+    for (const auto& patch : sweep) {
+      auto& Jp = points.emplace_back(J);
+      Jp.merge_patch(patch);
+      if (Jp["Simulation"]["WH"] != J["Simulation"]["WH"] || Jp["Simulation"]["dt"] != J["Simulation"]["dt"]) {
+        throw std::runtime_error("sweep can't vary Simulation.WH or Simulation.dt");
+      }
+    }
+  }
+  else {
+    points.push_back(J);
+  }
+
+  std::string ensemble_folder;
+  const auto& ja = J["Simulation"]["Analysis"];
+  if (ja.size() != 0 && ja["data_folder"] != "") {
+    ensemble_folder = analysis::unique_output_folder(ja).filename().string();
+  }
+  std::vector<json> runs;
+  for (size_t p = 0; p < points.size(); ++p) {
+    for (int r = 0; r < replicates; ++r) {
+      auto& Jr = runs.emplace_back(points[p]);
+      Jr["Simulation"]["seed"] = Jr["Simulation"]["seed"].get<uint64_t>() + uint64_t(r);
+      if (!ensemble_folder.empty()) {
+        Jr["Simulation"]["Analysis"]["run_folder"] = ensemble_folder + "/s" + std::to_string(p) + "_r" + std::to_string(r);
+      }
+    }
+  }
+  std::cout << "Running " << runs.size() << " simulations (" << points.size() << " x " << replicates << ")" << std::endl;
+
+  tbb::task_scheduler_init tbb_init(num_threads(J));
+  if (lockstep) {
+    tbb::parallel_for(size_t(0), points.size(), size_t(1), [&](size_t p) {
+      tbb::task_arena arena(run_threads);
+      arena.execute([&]() {
+        std::vector<std::unique_ptr<model::Simulation>> sims;
+        std::vector<std::vector<std::unique_ptr<Observer>>> chains;
+        std::vector<std::unique_ptr<Observer>> observers;
+        for (int r = 0; r < replicates; ++r) {
+          auto& Jr = runs[p * replicates + r];
+          sims.push_back(std::make_unique<model::Simulation>(Jr));
+          chains.push_back(analysis::CreateObserverChain<model::pigeon_tag>(Jr));
+          auto& observer = observers.emplace_back(std::make_unique<Observer>());
+          for (const auto& obs : chains.back()) {
+            observer->append_observer(obs.get());
+          }
+        }
+        std::vector<model::Simulation*> psims;
+        std::vector<model::Observer*> pobservers;
+        for (int r = 0; r < replicates; ++r) {
+          psims.push_back(sims[r].get());
+          pobservers.push_back(observers[r].get());
+        }
+        model::lockstep ls(psims);
+        simulate_lockstep(ls, initial_snapshot, pobservers, runs[p * replicates]);
+      });
+    }, tbb::simple_partitioner());
+    return;
+  }
+  tbb::parallel_for(size_t(0), runs.size(), size_t(1), [&](size_t i) {
+    tbb::task_arena arena(run_threads);
+    arena.execute([&]() {
+      auto& Jr = runs[i];
+      auto sim = std::make_unique<model::Simulation>(Jr);
+      auto observers = analysis::CreateObserverChain<model::pigeon_tag>(Jr);
+      auto observer = std::make_unique<Observer>();
+      for (const auto& obs : observers) {
+        observer->append_observer(obs.get());
+      }
+      simulate(sim.get(), initial_snapshot, observer.get(), Jr);
+    });
+  }, tbb::simple_partitioner());
+}
+
+
 int main(int argc, const char* argv[])
 {
   try {
@@ -107,6 +270,12 @@ int main(int argc, const char* argv[])
 
     auto J = compose_json(configs);
     J["Simulation"]["Analysis"]["Externals"]["configName"] = config_name;
+    if (!J["Simulation"].contains("seed")) {
+      // recorded in the composed config of the run
+      J["Simulation"]["seed"] = std::random_device{}();
+    }
+    // before any Simulation is constructed, in particular the concurrent ones of run_ensemble
+    model::Simulation::set_world(J);
     
     std::string exp_files;
     clp.optional("exp_files", exp_files);
@@ -114,7 +283,32 @@ int main(int argc, const char* argv[])
         save_json(J, "composed_config.json");
     }
     
-    run(J, clp.flag("--headless"));
+    std::filesystem::path trace_file = "";
+    if (clp.optional("--trace", trace_file)) {
+      size_t capacity = size_t(1) << 16;
+      clp.optional("--trace_capacity", capacity);
+      model::trace::enable(capacity);
+    }
+
+    int replicates = 0;
+    std::filesystem::path sweep_file = "";
+    const bool reps = clp.optional("--replicates", replicates);
+    const bool sweep = clp.optional("--sweep", sweep_file);
+    if (reps || sweep) {
+      int run_threads = 1;
+      clp.optional("--run_threads", run_threads);
+      run_ensemble(J, std::max(replicates, 1), sweep_file, std::max(run_threads, 1), clp.flag("--lockstep"));
+    }
+    else {
+      std::filesystem::path profile_file = "";
+      double profile_interval = 1.0;
+      clp.optional("--profile", profile_file);
+      clp.optional("--profile_interval", profile_interval);
+      run(J, clp.flag("--headless"), profile_file, profile_interval);
+    }
+    if (!trace_file.empty()) {
+      model::trace::write(trace_file);
+    }
     return 0;
   }
   catch (const std::exception& err) {
@@ -88,9 +88,13 @@ void AppWin::notify(long long lmsg, const model::Simulation& sim)
   }
 }
 
+// never blocks the model thread: the renderer picks up the
+// latest published frame, at most one flush is pending
 void AppWin::send_flush_message(const model::Simulation& sim)
 {
-  SendMessage(WM_FLUSH_STATE, 0, reinterpret_cast<uintptr_t>(&sim));
+  if (!flush_pending_.exchange(true)) {
+    PostMessage(WM_FLUSH_STATE, 0, reinterpret_cast<uintptr_t>(&sim));
+  }
   flush_ = false;
 }
 
@@ -110,6 +114,7 @@ void AppWin::notify_tick(const model::Simulation& sim)
 LRESULT AppWin::OnFlushState(UINT, WPARAM, LPARAM lpsim, BOOL&)
 {
   auto sim = reinterpret_cast<const model::Simulation*>(lpsim);
+  flush_pending_ = false;
   {
     std::lock_guard<std::mutex> _(appMutex_);
     renderer_->flush_state(*this, *sim);
@@ -241,7 +246,7 @@ LRESULT AppWin::OnKeyDown(UINT, WPARAM wParam, LPARAM lParam, BOOL& bHandled)
   }
 
   case 'P': {
-    sim_->visit<model::pred_tag>([](auto& p) {
+    sim_->visit_locked<model::pred_tag>([](auto& p) {
       std::cout << p.get_current_state() << ' ';
       });
     std::cout << std::endl;
@@ -96,6 +96,7 @@ private:
   // interaction with model thread
   mutable std::mutex appMutex_;
   std::atomic<bool> flush_ = false;
+  std::atomic<bool> flush_pending_ = false;
   std::atomic<bool> finished_ = false;
   bool perf_ = false;
 
@@ -3,6 +3,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 
 #include <cmath>
+#include <algorithm>
 #include <filesystem>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glmutils/perp_dot.hpp>
@@ -349,19 +350,22 @@ public:
     follow_.idx = -1;
     follow_.species = 0;
     follow_.flock = false;
+    follow_.resolve = false;
     if (species < model::n_species) {
       follow_.idx = static_cast<GLsizei>(idx);
       follow_.species = species;
       follow_.flock = flock;
+      follow_.resolve = true;
     }
   }
 
   void cs_render();
 
   struct follow_t {
-    GLsizei idx = -1;
+    GLsizei idx = -1;       // external id once resolved
     size_t species = 0;
     bool flock = false;
+    bool resolve = false;   // idx is the instance index of the last flush
     model::vec_t eye;
   };
   follow_t& follow() { return follow_; }
@@ -637,47 +641,61 @@ namespace {
 
 
   template <size_t I>
-  void flush_species(RendererImpl* self, const model::Simulation& sim, gl_species_array& gls)
+  void request_species(const model::Simulation& sim, const gl_species_array& gls)
+  {
+    sim.request_publication<std::integral_constant<size_t, I>>(gls[I].color_map);
+    request_species<I + 1>(sim, gls);
+  }
+
+  template <>
+  void request_species<model::n_species>(const model::Simulation&, const gl_species_array&)
+  {}
+
+
+  template <size_t I>
+  void flush_species(RendererImpl* self, const model::published_frame& frame, gl_species_array& gls)
   {
-    using Tag = std::integral_constant<size_t, I>;
     static_assert(std::is_trivially_destructible_v<model::instance_proxy>);
-    auto p_inst = gls[I].pInstance;
-    gls[I].size = static_cast<GLsizei>(sim.visit_all<std::integral_constant<size_t, I>>([psim = &sim, p = p_inst, cm = gls[I].color_map](const auto& ind, size_t idx, bool alive) mutable {
-      *p = ind.instance_proxy(cm, idx, psim);
-      p->alpha = alive ? 1.f : 0.f;
-      ++p;
-    }));
+    const auto& sf = frame.species[I];
+    std::copy(sf.instances.cbegin(), sf.instances.cend(), gls[I].pInstance);
+    gls[I].size = static_cast<GLsizei>(sf.instances.size());
     auto& follow = self->follow();
     if (follow.species == I && follow.idx >= 0) {
-      if (follow.flock) {
-        auto flockId = sim.flock_of<Tag>(follow.idx);
-        follow.eye = sim.flock_info<Tag>(flockId).gc();
+      if (follow.resolve) {
+        follow.idx = static_cast<GLsizei>(sf.ids[follow.idx]);
+        follow.resolve = false;
       }
-      else {
-        follow.eye = sim.pop<Tag>()[follow.idx].pos;
+      const auto it = std::find(sf.ids.cbegin(), sf.ids.cend(), static_cast<unsigned>(follow.idx));
+      if (it != sf.ids.cend()) {
+        const auto idx = std::distance(sf.ids.cbegin(), it);
+        follow.eye = follow.flock ? sf.flock_gc[idx] : sf.instances[idx].pos;
       }
     }
-    flush_species<I + 1>(self, sim, gls);
+    flush_species<I + 1>(self, frame, gls);
   }
 
   template <>
-  void flush_species<model::n_species>(RendererImpl* self, const model::Simulation&, gl_species_array&)
+  void flush_species<model::n_species>(RendererImpl* self, const model::published_frame&, gl_species_array&)
   {}
 
 }
 
 
+// consumes the latest frame published by the simulation, lock-free
 void RendererImpl::flush_state(const AppWin& app, const model::Simulation& sim)
 {
   cs::WaitForSync(render_sync_);
   DeleteSync(render_sync_);
-  tick_ = sim.tick();
   this->param_.sim = app.sim_param();
-  flush_species<0>(this, sim, gl_species_);
-  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
-  if (trail_config_.nextUpdate <= tick_) {
-    trail_config_.nextUpdate += trail_config_.interval;
-    for (auto& sp : gl_species_) sp.trail.push_back(sp.vbo_inst);
+  request_species<0>(sim, gl_species_);
+  if (const auto frame = sim.published()) {
+    tick_ = frame->tick;
+    flush_species<0>(this, *frame, gl_species_);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    if (trail_config_.nextUpdate <= tick_) {
+      trail_config_.nextUpdate += trail_config_.interval;
+      for (auto& sp : gl_species_) sp.trail.push_back(sp.vbo_inst);
+    }
   }
   flush_sync_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 }
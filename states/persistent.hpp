@@ -46,10 +46,10 @@ namespace model {
       void resume(agent_type* self, size_t idx, size_t T, const Simulation& sim) override
       {
 	     self->reaction_time = tr_;
-   	     self->sa = sai_;
-         self->sa.cruiseSpeed += self->ai.cruiseSpeedSd;
+   	     self->sa() = sai_;
+         self->sa().cruiseSpeed += self->ai.cruiseSpeedSd;
 
-        chain_actions<0>(self, idx, T, sim);
+        run_actions(self, idx, T, sim);
         if (T >= t_exit_) self->on_state_exit(idx, T, sim);
       };
     public:
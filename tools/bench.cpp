@@ -0,0 +1,237 @@
+// headless benchmark over a fixed scenario matrix
+//
+// bench [--time=2] [--out=bench.csv] [--match=substring] [--threads=N]
+//
+// Run from the folder holding config.json and species/ (as pigeon). Every
+// scenario patches the composed configuration (pigeons, predators, observers,
+// flock detection interval, WH), runs 'time' simulated seconds with a fixed
+// seed and appends one row to 'out': ticks/s, individual updates/s, peak RSS
+// and the share of the tick phases (model/profiler.hpp). The shares come from
+// a second, profiled run of the scenario, thus don't slow down the timed run.
+
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <tbb/tbb.h>
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+#include <game_watches.hpp>
+#include <libs/cmd_line.h>
+#include "model/json.hpp"
+#include "model/model.hpp"
+#include "agents/agents.hpp"
+#include "analysis/analysis_obs.hpp"
+
+
+namespace {
+
+  struct scenario
+  {
+    std::string name;
+    int pigeons;
+    int predators;
+    bool observers;
+    float flock_interval;   // [s]
+  };
+
+
+  std::vector<scenario> scenario_matrix()
+  {
+    std::vector<scenario> res;
+    for (int pigeons : { 10, 100, 1000, 10000 }) {
+      for (int predators : { 0, 1, 8 }) {
+        for (bool observers : { false, true }) {
+          for (float flock_interval : { 0.05f, 1.f }) {
+            const auto name = "N" + std::to_string(pigeons) + "_P" + std::to_string(predators)
+                            + (observers ? "_obs" : "_noobs") + (flock_interval < 1.f ? "_fi0.05" : "_fi1");
+            res.push_back({ name, pigeons, predators, observers, flock_interval });
+          }
+        }
+      }
+    }
+    return res;
+  }
+
+
+  // the observers of the default configuration, NeighbData limited to
+  // the interaction partners (full view is O(N^2) memory)
+  json bench_observers()
+  {
+    return json::parse(R"([
+      { "type": "TimeSeries", "sample_freq": 0.2, "output_name": "time_series" },
+      { "type": "NeighbData", "sample_freq": 0.2, "output_name": "all_neighbors", "k": 7 },
+      { "type": "FlockData", "sample_freq": 0.2, "output_name": "flocks" },
+      { "type": "CoordForces", "sample_freq": 0.2, "output_name": "forces" }
+    ])");
+  }
+
+
+  json scenario_config(const json& base, const scenario& sc, double time)
+  {
+    auto J = base;
+    auto& js = J["Simulation"];
+    js["Tmax"] = time;
+    js["seed"] = 1;
+    js["flockDetection"]["interval"] = sc.flock_interval;
+    auto& ja = js["Analysis"];
+    ja["data_folder"] = sc.observers ? "bench" : "";
+    ja["run_folder"] = sc.name;       // overwritten by the next bench run
+    ja["Observers"] = sc.observers ? bench_observers() : json::array();
+    J["Pigeon"]["N"] = sc.pigeons;
+    auto& ji = J["Pigeon"]["InitCondit"];
+    if (ji.value("type", "") == "flock") {
+      // constant initial density, the initial square (2 radius wide)
+      // shall not cover more than half of the torus
+      const double radius = ji["radius"].get<double>() * std::sqrt(sc.pigeons / 10.0);
+      ji["radius"] = radius;
+      js["WH"] = std::max(js["WH"].get<double>(), 4.0 * radius);
+    }
+    J["Pred"]["N"] = sc.predators;
+    return J;
+  }
+
+
+  // resets the peak resident set size (Linux, ignored elsewhere)
+  void reset_peak_rss()
+  {
+#ifdef __linux__
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+  }
+
+
+  // peak resident set size since reset_peak_rss [MB]
+  double peak_rss_mb()
+  {
+#ifdef __linux__
+    std::ifstream is("/proc/self/status");
+    for (std::string line; std::getline(is, line); ) {
+      if (line.compare(0, 6, "VmHWM:") == 0) return std::stod(line.substr(6)) / 1024.0;
+    }
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+# ifdef __APPLE__
+    return ru.ru_maxrss / (1024.0 * 1024.0);
+# else
+    return ru.ru_maxrss / 1024.0;
+# endif
+#else
+    return std::nan("");
+#endif
+  }
+
+
+  struct result
+  {
+    model::tick_t ticks = 0;
+    double wall = 0;        // [s]
+    uint64_t updates = 0;
+    double rss = 0;         // [MB]
+    std::array<double, static_cast<unsigned>(model::tick_phase::max_phase)> shares = {};
+  };
+
+
+  template <size_t... S>
+  uint64_t total_updates(const model::Simulation& sim, std::index_sequence<S...>)
+  {
+    return (sim.updates<std::integral_constant<size_t, S>>() + ...);
+  }
+
+
+  result run_scenario(json J, bool profile)
+  {
+    result res;
+    model::Simulation::set_world(J);
+    auto sim = std::make_unique<model::Simulation>(J);
+    auto observers = analysis::CreateObserverChain<model::pigeon_tag>(J);
+    auto observer = std::make_unique<model::Observer>();
+    for (const auto& obs : observers) {
+      observer->append_observer(obs.get());
+    }
+    if (profile) {
+      sim->profiler().enable(std::numeric_limits<model::tick_t>::max(), [&](const model::tick_profiler& prof, model::tick_t) {
+        const double tick = static_cast<double>(prof.histogram(model::tick_phase::tick, model::n_species).sum());
+        for (unsigned p = 0; p < res.shares.size(); ++p) {
+          for (size_t s = 0; s <= model::n_species; ++s) {
+            res.shares[p] += prof.histogram(model::tick_phase(p), s).sum() / tick;
+          }
+        }
+      });
+    }
+    const auto Tmax = sim->time2tick(double(J["Simulation"]["Tmax"]));
+    game_watches::stop_watch<> watch;
+    watch.start();
+    sim->initialize(observer.get(), {});
+    while (sim->tick() < Tmax) {
+      sim->update(observer.get());
+    }
+    sim->profiler().flush(sim->tick());
+    observer->notify(model::Simulation::Finished, *sim);
+    res.wall = watch.elapsed_seconds();
+    res.ticks = sim->tick();
+    res.updates = total_updates(*sim, std::make_index_sequence<model::n_species>());
+    return res;
+  }
+
+}
+
+
+int main(int argc, const char* argv[])
+{
+  try {
+    auto clp = cmd::cmd_line_parser(argc, argv);
+    double time = 2.0;
+    std::filesystem::path out = "bench.csv";
+    std::string match = "";
+    int threads = tbb::task_scheduler_init::default_num_threads();
+    clp.optional("--time", time);
+    clp.optional("--out", out);
+    clp.optional("--match", match);
+    clp.optional("--threads", threads);
+    tbb::task_scheduler_init tbb_init(threads);
+
+    const auto base = compose_json({ "config.json", "species/pigeon.json", "species/predator.json" });
+    std::ofstream os(out);
+    if (!os) throw std::runtime_error("can't create '" + out.string() + "'");
+    os << "scenario,pigeons,predators,observers,flock_interval,WH,threads,sim_time,ticks,wall_s,ticks_per_s,updates_per_s,peak_rss_mb";
+    for (unsigned p = 0; p < static_cast<unsigned>(model::tick_phase::tick); ++p) {
+      os << ",share_" << model::phase_name(model::tick_phase(p));
+    }
+    os << '\n';
+    const auto matrix = scenario_matrix();
+    run_scenario(scenario_config(base, matrix.front(), 1.0), false);    // warm-up: thread pool, allocator
+    for (const auto& sc : matrix) {
+      if (sc.name.find(match) == std::string::npos) continue;
+      const auto J = scenario_config(base, sc, time);
+      reset_peak_rss();
+      auto res = run_scenario(J, false);
+      res.rss = peak_rss_mb();
+      res.shares = run_scenario(J, true).shares;
+      os << sc.name << ',' << sc.pigeons << ',' << sc.predators << ',' << sc.observers << ',' << sc.flock_interval << ','
+         << J["Simulation"]["WH"].get<double>() << ',' << threads << ',' << time << ',' << res.ticks << ',' << res.wall << ',' << res.ticks / res.wall << ','
+         << res.updates / res.wall << ',' << res.rss;
+      for (unsigned p = 0; p < static_cast<unsigned>(model::tick_phase::tick); ++p) {
+        os << ',' << res.shares[p];
+      }
+      os << std::endl;
+      std::cout << sc.name << ": " << res.ticks / res.wall << " ticks/s, " << res.updates / res.wall << " updates/s, "
+                << res.rss << " MB" << std::endl;
+    }
+    return 0;
+  }
+  catch (const std::exception& err) {
+    std::cerr << err.what() << '\n';
+  }
+  return -1;
+}
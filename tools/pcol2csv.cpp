@@ -0,0 +1,45 @@
+// converts columnar observer tables (.pcol) to csv
+//
+// pcol2csv [-p digits|shortest] table.pcol [table.pcol ...]   writes table.csv next to each input
+// pcol2csv [-p digits|shortest] table.pcol -                  writes to stdout
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include "analysis/table_io.hpp"
+
+
+int main(int argc, const char** argv)
+{
+  int precision = 6;
+  int first = 1;
+  try {
+    if (argc > 2 && std::string(argv[1]) == "-p") {
+      const std::string p = argv[2];
+      precision = (p == "shortest") ? analysis::parse_csv_precision(p) : std::stoi(p);
+      first = 3;
+    }
+    if (argc <= first) {
+      std::cerr << "usage: pcol2csv [-p digits|shortest] table.pcol [table.pcol ...]\n"
+                << "       pcol2csv [-p digits|shortest] table.pcol -\n";
+      return 1;
+    }
+    if (argc == first + 2 && std::string(argv[first + 1]) == "-") {
+      analysis::columnar::to_csv(argv[first], std::cout, precision);
+      return 0;
+    }
+    for (int i = first; i < argc; ++i) {
+      const auto out_path = std::filesystem::path(argv[i]).replace_extension(".csv");
+      std::ofstream os(out_path);
+      if (!os) throw std::runtime_error("can't create '" + out_path.string() + "'");
+      analysis::columnar::to_csv(argv[i], os, precision);
+      std::cout << argv[i] << " -> " << out_path.string() << '\n';
+    }
+  }
+  catch (std::exception& err) {
+    std::cerr << err.what() << '\n';
+    return 1;
+  }
+  return 0;
+}